@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #ifndef action_H
 #define action_H
 
@@ -5,28 +7,35 @@
 using namespace std;
 
 
+// A move of the top tile of one column onto another
+// Only the two columns are kept so that an action is a few bytes, the
+// searches keep any score they need next to it (see ScoredAction)
 class Action {
-  int fromCol;
-  int toCol;
-  double heuristic;
+  int16_t fromCol;
+  int16_t toCol;
 
   public:
-    Action() {}; // Empty constructor (do not construct like this unless it is a placeholder)
-    Action(int f, int t) : fromCol(f), toCol(t) {};
-    Action(int f, int t, double hu) : fromCol(f), toCol(t), heuristic(hu) {};
+    Action() : fromCol(-1), toCol(-1) {}; // Placeholder that is no move, and so undoes none either
+    Action(int f, int t) : fromCol((int16_t)f), toCol((int16_t)t) {};
 
-    bool operator>(const Action& otherAct) const {return heuristic > otherAct.getHeuristic();};
     bool operator==(Action& otherAct);
 
     int getFromCol() {return fromCol;};
     int getToCol() {return toCol;}
-    double getHeuristic() const {return heuristic;};
-    void setHeuristic(double hu) {heuristic = hu;};
     bool isReverseOf(Action& otherAct);
     void show();
     void showHumanReadable();
 };
 
+
+// An action with the heuristic of the state it leads to, lower is better
+struct ScoredAction {
+    double heuristic;
+    Action act;
+
+    bool operator>(const ScoredAction& other) const {return heuristic > other.heuristic;};
+};
+
 // Equality operator
 bool Action::operator==(Action& otherAct) {
     return fromCol == otherAct.getFromCol() && toCol == otherAct.getToCol();
@@ -0,0 +1,171 @@
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <stddef.h>
+#include <new>
+
+using namespace std;
+
+#ifndef arena_H
+#define arena_H
+
+
+// Bytes in one slab of an arena
+const size_t ARENA_SLAB_BYTES = 1 << 16;
+// Every block is rounded up to and aligned on this many bytes
+const size_t ARENA_ALIGN = 16;
+// Largest block served from the slabs, bigger ones (such as the bucket arrays
+// of a hash table) are rare and go to the heap
+const size_t ARENA_MAX_BLOCK = 1024;
+
+
+// Memory for the nodes of one solve, released all at once when it ends
+// Blocks are cut from large slabs one after another. A freed block goes on a
+// free list for its size and is handed out again before the slab is cut any
+// further, so searches that keep making and dropping nodes of a few sizes
+// (boards, hash table nodes) reuse the same memory. release() takes every
+// slab back at once without returning them to the heap, so an arena that is
+// reused by the next solve doesn't allocate again once it has grown.
+// An arena is not thread safe, each thread needs its own.
+class Arena {
+  vector<char*> slabs;
+  size_t current; // Index of the slab being cut
+  size_t used; // Bytes cut from the current slab
+  void* freeBlocks[ARENA_MAX_BLOCK / ARENA_ALIGN + 1]; // Free list of each size
+
+  static size_t sizeClass(size_t bytes) {return (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN;};
+
+  public:
+    Arena();
+    void* allocate(size_t bytes);
+    void deallocate(void* p, size_t bytes);
+    template<class T> void destroy(T* p);
+    void release();
+    size_t getReserved() {return slabs.size() * ARENA_SLAB_BYTES;};
+    ~Arena();
+
+  private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+};
+
+
+// Hands the memory of an arena to a standard container
+// Freed nodes go back to the arena's free lists, the rest stays until the
+// arena is released, so the container must be gone by then
+template<class T>
+class ArenaAllocator {
+  public:
+    typedef T value_type;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena* a) : arena(a) {};
+    template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {};
+    T* allocate(size_t n) {return (T*)arena->allocate(n * sizeof(T));};
+    void deallocate(T* p, size_t n) {arena->deallocate(p, n * sizeof(T));};
+    template<class U> struct rebind {typedef ArenaAllocator<U> other;};
+};
+
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+
+// Hash tables whose nodes come from an arena, built with
+// `ArenaMap<K, V> m(0, hash<K>(), equal_to<K>(), &arena)`
+template<class K, class V>
+using ArenaMap = unordered_map<K, V, hash<K>, equal_to<K>, ArenaAllocator< pair<const K, V> > >;
+template<class K>
+using ArenaSet = unordered_set<K, hash<K>, equal_to<K>, ArenaAllocator<K> >;
+
+
+Arena::Arena() : current(0), used(0) {
+    for (size_t i = 0; i <= ARENA_MAX_BLOCK / ARENA_ALIGN; i++) {
+        freeBlocks[i] = NULL;
+    }
+}
+
+
+// Gets a block of at least `bytes`, aligned on ARENA_ALIGN
+void* Arena::allocate(size_t bytes) {
+    if (bytes > ARENA_MAX_BLOCK) {
+        return ::operator new(bytes);
+    }
+    size_t c = sizeClass(bytes == 0 ? 1 : bytes);
+    // Reuse a freed block of the same size first
+    if (freeBlocks[c] != NULL) {
+        void* block = freeBlocks[c];
+        freeBlocks[c] = *(void**)block;
+        return block;
+    }
+    size_t rounded = c * ARENA_ALIGN;
+    if (slabs.empty() || used + rounded > ARENA_SLAB_BYTES) {
+        // Move on to the next slab, keeping any left from before a release
+        if (!slabs.empty()) {
+            current++;
+        }
+        if (current == slabs.size()) {
+            slabs.push_back((char*)::operator new(ARENA_SLAB_BYTES));
+        }
+        used = 0;
+    }
+    void* block = slabs[current] + used;
+    used += rounded;
+    return block;
+}
+
+
+// Gives back a block from allocate, `bytes` must be the size it was asked for
+void Arena::deallocate(void* p, size_t bytes) {
+    if (p == NULL) {
+        return;
+    }
+    if (bytes > ARENA_MAX_BLOCK) {
+        ::operator delete(p);
+        return;
+    }
+    size_t c = sizeClass(bytes == 0 ? 1 : bytes);
+    *(void**)p = freeBlocks[c];
+    freeBlocks[c] = p;
+}
+
+
+// Destroys an object built in a block of the arena and frees the block
+template<class T>
+void Arena::destroy(T* p) {
+    if (p != NULL) {
+        p->~T();
+        deallocate(p, sizeof(T));
+    }
+}
+
+
+// Takes back every block at once, the slabs are kept for the next solve
+// Anything still using the arena's memory must be gone before this
+void Arena::release() {
+    current = 0;
+    used = 0;
+    for (size_t i = 0; i <= ARENA_MAX_BLOCK / ARENA_ALIGN; i++) {
+        freeBlocks[i] = NULL;
+    }
+}
+
+
+Arena::~Arena() {
+    for (vector<char*>::iterator i = slabs.begin(); i != slabs.end(); i++) {
+        ::operator delete(*i);
+    }
+}
+
+
+#endif
@@ -20,6 +20,7 @@ class AtomGoal : public Goal {
     bool isValid(State* gameState);
     bool isSatisfied(State* gameState);
     double getHeuristic(State* gameState);
+    Goal* clone() {return new AtomGoal(goalTuple[0], goalTuple[1], goalTuple[2]);};
 };
 
 // Shows a human readable atom goal
@@ -43,8 +44,7 @@ bool AtomGoal::isValid(State* gameState) {
 
 // Uses the game state to check whether the goal is satisfied
 bool AtomGoal::isSatisfied(State* gameState) {
-    int** tempBoard = gameState->getBoard();
-    return goalTuple[0] == tempBoard[goalTuple[1]][goalTuple[2]];
+    return goalTuple[0] == gameState->at(goalTuple[1], goalTuple[2]);
 }
 
 
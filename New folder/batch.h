@@ -0,0 +1,297 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <chrono>
+
+#include "constants.h"
+#include "state.h"
+#include "action.h"
+#include "goal.h"
+#include "goalList.h"
+#include "atomGoal.h"
+#include "neighbourGoal.h"
+#include "conjunctiveGoalList.h"
+#include "disjunctiveGoalList.h"
+#include "solver.h"
+#include "arena.h"
+#include "patternDatabase.h"
+#include "planCache.h"
+#include "transpositionTable.h"
+
+using namespace std;
+
+#ifndef batch_H
+#define batch_H
+
+
+// Headless batch mode
+//
+// Problems are read one after another from a stream of whitespace separated
+// tokens, anything after a `#` on a line is a comment:
+//
+//   size nums
+//   size * size tiles, row by row from the bottom row, 0 for an empty cell
+//   conjunctive|disjunctive goalCount
+//   goalCount goal tuples (a b c), b < 0 makes it a neighbour goal
+//
+// Each problem is solved and reported as one JSON object per line:
+//
+//   {"problem":1,"solver":"astar","solved":true,"length":2,
+//    "plan":[[0,1],[2,0]],"time_ms":0.153,"nodes":14,"generated":84,
+//    "table_hits":30,"table_misses":54,"heuristic_evals":55,"max_depth":1,
+//    "peak_table":55}
+//
+// A problem that cannot be read is reported with an "error" field instead.
+// A problem whose tokens were all read but make no sense, such as a goal
+// naming a tile that isn't there, is skipped and the next one is solved; a
+// malformed stream stops the batch.
+
+// Largest board size a batch problem may give, beyond it the stream is
+// taken to be malformed rather than the board too big
+const int MAX_BATCH_SIZE = 64;
+
+bool readToken(istream& in, string& token);
+bool parseInt(const string& token, int& value);
+bool readInt(istream& in, int& value);
+bool validBoard(int size, int nums, vector<int>& tiles);
+string readProblem(istream& in, State*& board, GoalList*& goals, bool& synced);
+void writeResult(ostream& out, int problem, int strategy, Solver& solver, bool solved, double millis);
+int runBatch(
+    istream& in, ostream& out, int strategy, int limit, PatternDatabase* patterns=NULL, PlanCache* cache=NULL,
+    size_t tableBytes=DEFAULT_TABLE_BYTES, const SolverOptions& options=SolverOptions()
+);
+
+
+// Reads the next token, skipping comments
+// Returns false at the end of the stream
+bool readToken(istream& in, string& token) {
+    while (in >> token) {
+        if (token[0] != '#') {
+            return true;
+        }
+        // Throw away the rest of the comment line
+        string rest;
+        getline(in, rest);
+    }
+    return false;
+}
+
+
+// Converts a whole token to an integer, returns false if it is not one
+bool parseInt(const string& token, int& value) {
+    size_t used = 0;
+    try {
+        value = stoi(token, &used);
+    }
+    catch (...) {
+        return false;
+    }
+    return used == token.size();
+}
+
+
+// Reads the next token as an integer, returns false if it is not one
+bool readInt(istream& in, int& value) {
+    string token;
+    return readToken(in, token) && parseInt(token, value);
+}
+
+
+// Checks that a board definition can be loaded into a State
+// Every tile from 1 to nums must appear exactly once and no tile may float
+// above an empty cell
+bool validBoard(int size, int nums, vector<int>& tiles) {
+    if (size < 2 || size > nums || nums > size * size - size) {
+        return false;
+    }
+    vector<bool> seen(nums + 1, false);
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            int tile = tiles[(x * size) + y];
+            if (tile < 0 || tile > nums || (tile > 0 && seen[tile])) {
+                return false;
+            }
+            if (tile > 0 && x > 0 && tiles[((x - 1) * size) + y] == 0) {
+                return false;
+            }
+            if (tile > 0) {
+                seen[tile] = true;
+            }
+        }
+    }
+    for (int i = 1; i <= nums; i++) {
+        if (!seen[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Reads one problem, setting `board` and `goals` which the caller must delete
+// Returns an empty string on success, "end" when there are no more problems
+// and otherwise a description of what was wrong
+// `synced` is left true when every token of the problem was read even though
+// it was wrong, so the next problem can still be read; it is set false when
+// the tokens themselves were malformed or ran out
+string readProblem(istream& in, State*& board, GoalList*& goals, bool& synced) {
+    board = NULL;
+    goals = NULL;
+    synced = false;
+    string token;
+    int size, nums;
+
+    if (!readToken(in, token)) {
+        synced = true;
+        return "end";
+    }
+    if (!parseInt(token, size)) {
+        return "expected the board size";
+    }
+    if (!readInt(in, nums)) {
+        return "expected the number of tiles";
+    }
+    // Without a sensible size it isn't known how many tiles follow
+    if (size < 1 || size > MAX_BATCH_SIZE) {
+        return "invalid board size";
+    }
+
+    vector<int> tiles(size * size);
+    for (int i = 0; i < size * size; i++) {
+        if (!readInt(in, tiles[i])) {
+            return "expected " + to_string(size * size) + " tiles";
+        }
+    }
+
+    int goalCount;
+    string type;
+    if (!readToken(in, type) || !readInt(in, goalCount) || goalCount < 1) {
+        return "expected the goal type and count";
+    }
+    vector<int> tuples;
+    for (int i = 0; i < goalCount; i++) {
+        int a, b, c;
+        if (!readInt(in, a) || !readInt(in, b) || !readInt(in, c)) {
+            return "expected " + to_string(goalCount) + " goals";
+        }
+        tuples.push_back(a);
+        tuples.push_back(b);
+        tuples.push_back(c);
+    }
+    // Every token has been read, anything wrong from here on is only this problem's
+    synced = true;
+
+    if (size < 2 || size > nums || nums > size * size - size) {
+        return "invalid board size or number of tiles";
+    }
+    if (!validBoard(size, nums, tiles)) {
+        return "invalid board layout";
+    }
+    if (type[0] == 'c') {
+        goals = new ConjunctiveGoalList();
+    }
+    else if (type[0] == 'd') {
+        goals = new DisjunctiveGoalList();
+    }
+    else {
+        return "goal type must be conjunctive or disjunctive";
+    }
+
+    board = new State(size, nums, &tiles[0]);
+    for (int i = 0; i < goalCount; i++) {
+        int a = tuples[i * 3];
+        int b = tuples[(i * 3) + 1];
+        int c = tuples[(i * 3) + 2];
+        Goal* goal;
+        if (b < 0) {
+            goal = new NeighbourGoal(a, b, c);
+        }
+        else {
+            goal = new AtomGoal(a, b, c);
+        }
+        if (!goal->isValid(board)) {
+            delete goal;
+            return "invalid goal " + to_string(i + 1);
+        }
+        goals->addGoal(goal);
+    }
+    return "";
+}
+
+
+// Writes the result of one solve as a JSON line
+void writeResult(ostream& out, int problem, int strategy, Solver& solver, bool solved, double millis) {
+    list<Action>& plan = solver.getPlan();
+    out << "{\"problem\":" << problem;
+    out << ",\"solver\":\"" << STRATEGY_KEYS[strategy] << "\"";
+    out << ",\"solved\":" << (solved ? "true" : "false");
+    out << ",\"length\":" << (solved ? (int)plan.size() : -1);
+    out << ",\"plan\":[";
+    if (solved) {
+        for (list<Action>::iterator i = plan.begin(); i != plan.end(); i++) {
+            out << (i == plan.begin() ? "" : ",") << "[" << i->getFromCol() << "," << i->getToCol() << "]";
+        }
+    }
+    const SearchStats& stats = solver.getStats();
+    out << "],\"time_ms\":" << millis;
+    out << ",\"nodes\":" << stats.nodesExpanded;
+    out << ",\"generated\":" << stats.successorsGenerated;
+    out << ",\"table_hits\":" << stats.tableHits;
+    out << ",\"table_misses\":" << stats.tableMisses;
+    out << ",\"heuristic_evals\":" << stats.heuristicEvaluations;
+    out << ",\"max_depth\":" << stats.maxDepth;
+    out << ",\"peak_table\":" << stats.peakTableEntries << "}" << endl;
+}
+
+
+// Solves every problem in the stream with one strategy
+// `limit` is passed to the strategy as its step, recursion or plan limit
+// `patterns`, if given, is used on every problem it fits and `cache`, if
+// given, is looked up before every search and keeps every plan found
+// `tableBytes` is the memory budget of each best first search's table and
+// `options` are the switches of every solver
+// Returns the number of problems that could not be read
+int runBatch(
+    istream& in, ostream& out, int strategy, int limit, PatternDatabase* patterns, PlanCache* cache,
+    size_t tableBytes, const SolverOptions& options
+) {
+    int errors = 0;
+    Arena arena; // Shared by the solves so its slabs are only allocated once
+    for (int problem = 1; ; problem++) {
+        State* board;
+        GoalList* goals;
+        bool synced;
+        string error = readProblem(in, board, goals, synced);
+        if (error == "end") {
+            break;
+        }
+        if (!error.empty()) {
+            out << "{\"problem\":" << problem << ",\"error\":\"" << error << "\"}" << endl;
+            delete board;
+            delete goals;
+            errors++;
+            // A problem that was read whole only spoils itself, otherwise
+            // the rest of the stream can no longer be trusted
+            if (synced) {
+                continue;
+            }
+            break;
+        }
+
+        Solver solver(board, goals);
+        solver.setArena(&arena);
+        solver.setPatternDatabase(patterns);
+        solver.setPlanCache(cache);
+        solver.setTableBudget(tableBytes);
+        solver.setOptions(options);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool solved = solver.solve(strategy, limit);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        writeResult(out, problem, strategy, solver, solved, elapsed.count());
+    }
+    return errors;
+}
+
+
+#endif
@@ -0,0 +1,534 @@
+// Benchmark suite for the solvers
+//
+// Generates seeded random instances over a range of board sizes and tile
+// counts, runs every chosen solver on each of them and writes one result row
+// per run. The same options always produce the same instances, so the output
+// of two builds can be compared to catch regressions. By seed, instances
+// rotate through a single atom goal, a single neighbour goal, a disjunction
+// of both and a conjunction of several goals taken from one target board.
+//
+// Build with the Benchmark project, or on other platforms with:
+//   g++ -std=c++14 -O2 -pthread -o bench bench.cpp
+//
+// Usage: bench [--solvers random,bfs,astar,idastar,hdastar,walks] [--instances n]
+//              [--seed n] [--max-size n] [--limit n] [--format csv|json]
+//              [--out file] [--pdb file] [--plan-cache file] [--threads n]
+//              [--walks n] [--no-fixed-states] [--no-bit-states]
+//              [--no-bidirectional] [--no-symmetry] [--no-fillers]
+// A pattern database is used on the instances it fits. A plan cache is
+// shared by every run, so a solver finds the plans stored by the runs before it.
+//
+// Columns (csv) and fields (json), in this order:
+//   solver, size, nums, seed, type, goals, solved, length, nodes, time_ms,
+//   nodes_per_sec, peak_rss_kb
+// `peak_rss_kb` is the peak resident memory of that run alone: every run is
+// made in a child process of its own (a fork, or on Windows the bench started
+// again with --instance) which measures its own peak and sends its result
+// back through a pipe. A child starts with the bench's own couple of MB
+// (mostly the C++ runtime) already resident, so those are in every row.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <io.h>
+#include <fcntl.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "constants.h"
+#include "state.h"
+#include "action.h"
+#include "goal.h"
+#include "goalList.h"
+#include "atomGoal.h"
+#include "neighbourGoal.h"
+#include "conjunctiveGoalList.h"
+#include "disjunctiveGoalList.h"
+#include "patternDatabase.h"
+#include "planCache.h"
+#include "solverOptions.h"
+#include "solver.h"
+
+
+// Kinds of instance, the seed picks one in turn
+const int ATOM_INSTANCE = 0; // A single atom goal
+const int NEIGHBOUR_INSTANCE = 1; // A single neighbour goal
+const int EITHER_INSTANCE = 2; // A disjunction of an atom and a neighbour goal
+const int ALL_INSTANCE = 3; // A conjunction of goals that one board satisfies
+const int INSTANCE_KINDS = 4;
+
+
+// What every run is given besides its instance
+struct BenchConfig {
+  int limit;
+  SolverOptions options;
+  string pdbPath; // Empty when there is none
+  string cachePath; // Empty when there is none
+};
+
+
+// The outcome of running one solver on one instance
+struct BenchResult {
+  int strategy;
+  int size;
+  int nums;
+  unsigned int seed;
+  bool conjunctive;
+  int goals;
+  bool solved;
+  int length;
+  long nodes;
+  double millis;
+  long peakKB;
+};
+
+
+// Totals for one solver over the whole run
+struct BenchTotals {
+  int runs;
+  int solved;
+  long nodes;
+  double millis;
+};
+
+
+long peakMemoryKB();
+void makeInstance(int size, int nums, unsigned int seed, State*& board, GoalList*& goals);
+void addTargetGoals(int size, int nums, GoalList* goals);
+BenchResult describeInstance(int strategy, int size, int nums, unsigned int seed);
+BenchResult runInstance(int strategy, int size, int nums, unsigned int seed, const BenchConfig& config);
+BenchResult runIsolated(int strategy, int size, int nums, unsigned int seed, const BenchConfig& config);
+int instanceMain(int count, char** args);
+void writeHeader(ostream& out, bool json);
+void writeResult(ostream& out, bool json, BenchResult& result);
+bool parseSolvers(string list, vector<int>& strategies);
+
+
+int main(int argc, char** argv) {
+  vector<int> strategies;
+  int instances = 20;
+  unsigned int baseSeed = 1;
+  int maxSize = 5;
+  bool json = false;
+  string file = "";
+  BenchConfig config;
+  config.limit = 50;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    int option;
+    if (arg == "--solvers" && hasValue) {
+      if (!parseSolvers(argv[++i], strategies)) {
+        return 2;
+      }
+    } else if (arg == "--instances" && hasValue) {
+      instances = atoi(argv[++i]);
+    } else if (arg == "--seed" && hasValue) {
+      baseSeed = (unsigned int)atol(argv[++i]);
+    } else if (arg == "--max-size" && hasValue) {
+      maxSize = atoi(argv[++i]);
+    } else if (arg == "--limit" && hasValue) {
+      config.limit = atoi(argv[++i]);
+    } else if (arg == "--format" && hasValue) {
+      json = string(argv[++i]) == "json";
+    } else if (arg == "--out" && hasValue) {
+      file = argv[++i];
+    } else if (arg == "--pdb" && hasValue) {
+      // Loaded here only to check it, every run loads its own
+      config.pdbPath = argv[++i];
+      PatternDatabase patterns;
+      if (!patterns.load(config.pdbPath)) {
+        cerr << "Could not load the pattern database " << config.pdbPath << endl;
+        return 2;
+      }
+    } else if (arg == "--plan-cache" && hasValue) {
+      config.cachePath = argv[++i];
+      PlanCache cache;
+      if (!cache.open(config.cachePath)) {
+        cerr << "Could not open the plan cache " << config.cachePath << endl;
+        return 2;
+      }
+    } else if (arg == "--instance" && i + 5 < argc) {
+      // How runIsolated starts a run on Windows, not for people
+      return instanceMain(argc - i - 1, argv + i + 1);
+    } else if ((option = readSolverOption(argc, argv, i, config.options)) != 0) {
+      if (option < 0) {
+        return 2;
+      }
+    } else {
+      cerr << "Usage: " << argv[0] << " [--solvers random,bfs,astar,idastar,hdastar,walks] [--instances n] [--seed n]"
+           << " [--max-size n] [--limit n] [--format csv|json] [--out file] [--pdb file] [--plan-cache file]" << endl
+           << "       " << SOLVER_OPTIONS_USAGE << endl;
+      return 2;
+    }
+  }
+  if (strategies.empty()) {
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+      strategies.push_back(i);
+    }
+  }
+
+  ofstream fileOut;
+  if (!file.empty()) {
+    fileOut.open(file.c_str());
+    if (!fileOut) {
+      cerr << "Could not open " << file << endl;
+      return 2;
+    }
+  }
+  ostream& out = file.empty() ? cout : fileOut;
+
+  vector<BenchTotals> totals(STRATEGY_COUNT, BenchTotals());
+  writeHeader(out, json);
+  // The fewest and the most tiles each board size allows
+  for (int size = 3; size <= maxSize; size++) {
+    int tileCounts[] = {size, size * size - size};
+    for (int t = 0; t < 2; t++) {
+      for (int i = 0; i < instances; i++) {
+        for (int s = 0; s < (int)strategies.size(); s++) {
+          BenchResult result = runIsolated(strategies[s], size, tileCounts[t], baseSeed + i, config);
+          writeResult(out, json, result);
+
+          BenchTotals& total = totals[result.strategy];
+          total.runs++;
+          total.solved += result.solved ? 1 : 0;
+          total.nodes += result.nodes;
+          total.millis += result.millis;
+        }
+      }
+    }
+  }
+
+  // A short summary for people, the rows above are for tools
+  for (int s = 0; s < (int)strategies.size(); s++) {
+    BenchTotals& total = totals[strategies[s]];
+    cerr << STRATEGY_KEYS[strategies[s]] << ": solved " << total.solved << "/" << total.runs
+         << ", " << total.nodes << " nodes in " << total.millis << " ms ("
+         << (total.millis > 0 ? (long)(total.nodes / (total.millis / 1000.0)) : 0) << " nodes/s)" << endl;
+  }
+  return 0;
+}
+
+
+// Returns the peak resident memory of the process in kilobytes
+long peakMemoryKB() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return (long)(counters.PeakWorkingSetSize / 1024);
+  }
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  // macOS reports bytes rather than kilobytes
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+// Builds the instance for a seed, the caller must delete `board` and `goals`
+// The kind of instance goes round with the seed, and every instance can be solved
+void makeInstance(int size, int nums, unsigned int seed, State*& board, GoalList*& goals) {
+  srand(seed);
+  board = new State(size, nums);
+  int kind = seed % INSTANCE_KINDS;
+  if (kind == ALL_INSTANCE) {
+    goals = new ConjunctiveGoalList();
+    addTargetGoals(size, nums, goals);
+    return;
+  }
+  if (kind == EITHER_INSTANCE) {
+    goals = new DisjunctiveGoalList();
+  } else {
+    goals = new ConjunctiveGoalList();
+  }
+
+  for (int type = 0; type < 2; type++) {
+    bool atom = type == 0;
+    if ((kind == ATOM_INSTANCE && !atom) || (kind == NEIGHBOUR_INSTANCE && atom)) {
+      continue;
+    }
+    Goal* goal;
+    // Random goals can be impossible, draw until one is valid
+    do {
+      if (atom) {
+        goal = new AtomGoal(board);
+      } else {
+        goal = new NeighbourGoal(board);
+      }
+      if (!goal->isValid(board)) {
+        delete goal;
+        goal = NULL;
+      }
+    } while (goal == NULL);
+    goals->addGoal(goal);
+  }
+}
+
+
+// Adds goals that all hold on one random board of `size` with `nums` tiles,
+// so that together they can be reached: two tiles where that board has them
+// and, when it stacks any tiles, its lowest left tile that sits on another
+void addTargetGoals(int size, int nums, GoalList* goals) {
+  State target(size, nums);
+  int first = getRand(1, nums);
+  int second;
+  do {
+    second = getRand(1, nums);
+  } while (second == first);
+  int tiles[] = {first, second};
+  for (int i = 0; i < 2; i++) {
+    int row, col;
+    target.find(tiles[i], row, col);
+    goals->addGoal(new AtomGoal(tiles[i], row, col));
+  }
+
+  for (int col = 0; col < size; col++) {
+    if (target.getHeight(col) > 1) {
+      goals->addGoal(new NeighbourGoal(target.at(1, col), ABOVE, target.at(0, col)));
+      return;
+    }
+  }
+}
+
+
+// The result of a run on an instance that hasn't been made, unsolved and
+// with a peak of -1
+BenchResult describeInstance(int strategy, int size, int nums, unsigned int seed) {
+  State* board;
+  GoalList* goals;
+  makeInstance(size, nums, seed, board, goals);
+  BenchResult result = BenchResult();
+  result.strategy = strategy;
+  result.size = size;
+  result.nums = nums;
+  result.seed = seed;
+  result.conjunctive = goals->isConjunctive();
+  result.goals = (int)goals->getGoals().size();
+  result.length = -1;
+  result.peakKB = -1;
+  delete board;
+  delete goals;
+  return result;
+}
+
+
+// Runs one solver on one instance and measures it
+// Random search and random walks are given ten times the limit, as in the
+// portfolio
+BenchResult runInstance(int strategy, int size, int nums, unsigned int seed, const BenchConfig& config) {
+  BenchResult result = describeInstance(strategy, size, nums, seed);
+  State* board;
+  GoalList* goals;
+  makeInstance(size, nums, seed, board, goals);
+  PatternDatabase patterns;
+  PlanCache cache;
+
+  // The solver seeds its own generator from rand, so reseed to keep random
+  // search independent of how many goals had to be drawn
+  srand(seed);
+  Solver solver(board, goals);
+  solver.setOptions(config.options);
+  if (!config.pdbPath.empty() && patterns.load(config.pdbPath)) {
+    solver.setPatternDatabase(&patterns);
+  }
+  if (!config.cachePath.empty() && cache.open(config.cachePath)) {
+    solver.setPlanCache(&cache);
+  }
+  int limit = config.limit;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  result.solved = solver.solve(strategy, strategy == RANDOM_SEARCH || strategy == RANDOM_WALK_SEARCH ? limit * 10 : limit);
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  result.length = result.solved ? (int)solver.getPlan().size() : -1;
+  result.nodes = solver.getNodesExpanded();
+  result.millis = elapsed.count();
+  result.peakKB = peakMemoryKB();
+  return result;
+}
+
+
+// Runs one solver on one instance in a child process, so that its peak
+// memory is its own and not that of every run before it
+// A child that fails is reported as unsolved with a peak of -1
+BenchResult runIsolated(int strategy, int size, int nums, unsigned int seed, const BenchConfig& config) {
+  BenchResult result = describeInstance(strategy, size, nums, seed);
+  BenchResult child;
+  size_t got = 0;
+
+#ifdef _WIN32
+  SECURITY_ATTRIBUTES attributes = {sizeof(attributes), NULL, TRUE};
+  HANDLE readPipe, writePipe;
+  if (!CreatePipe(&readPipe, &writePipe, &attributes, 0)) {
+    return result;
+  }
+  SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+  char program[MAX_PATH];
+  GetModuleFileNameA(NULL, program, MAX_PATH);
+  stringstream command;
+  command << "\"" << program << "\" --instance " << strategy << " " << size << " " << nums << " " << seed << " " << config.limit;
+  if (!config.pdbPath.empty()) {
+    command << " --pdb \"" << config.pdbPath << "\"";
+  }
+  if (!config.cachePath.empty()) {
+    command << " --plan-cache \"" << config.cachePath << "\"";
+  }
+  command << " " << formatSolverOptions(config.options);
+  string line = command.str();
+  vector<char> commandLine(line.begin(), line.end());
+  commandLine.push_back('\0');
+
+  STARTUPINFOA startup;
+  ZeroMemory(&startup, sizeof(startup));
+  startup.cb = sizeof(startup);
+  startup.dwFlags = STARTF_USESTDHANDLES;
+  startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+  startup.hStdOutput = writePipe;
+  startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+  PROCESS_INFORMATION process;
+  bool started = CreateProcessA(program, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &startup, &process) != 0;
+  // Only the child may hold the write end, or the read below never ends
+  CloseHandle(writePipe);
+  if (started) {
+    DWORD count;
+    while (got < sizeof(child) && ReadFile(readPipe, (char*)&child + got, (DWORD)(sizeof(child) - got), &count, NULL) && count > 0) {
+      got += count;
+    }
+    WaitForSingleObject(process.hProcess, INFINITE);
+    CloseHandle(process.hProcess);
+    CloseHandle(process.hThread);
+  }
+  CloseHandle(readPipe);
+#else
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return result;
+  }
+  // Anything still buffered would otherwise be written by both processes
+  cout.flush();
+  cerr.flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    BenchResult mine = runInstance(strategy, size, nums, seed, config);
+    size_t sent = 0;
+    while (sent < sizeof(mine)) {
+      ssize_t count = write(fds[1], (char*)&mine + sent, sizeof(mine) - sent);
+      if (count <= 0) {
+        break;
+      }
+      sent += count;
+    }
+    _exit(sent == sizeof(mine) ? 0 : 1);
+  }
+  close(fds[1]);
+  if (pid > 0) {
+    ssize_t count;
+    while (got < sizeof(child) && (count = read(fds[0], (char*)&child + got, sizeof(child) - got)) > 0) {
+      got += count;
+    }
+    waitpid(pid, NULL, 0);
+  }
+  close(fds[0]);
+#endif
+
+  return got == sizeof(child) ? child : result;
+}
+
+
+// Runs one instance given as `strategy size nums seed limit` followed by the
+// pattern database, plan cache and solver options and writes its result to
+// stdout as raw bytes for runIsolated
+int instanceMain(int count, char** args) {
+#ifdef _WIN32
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  BenchConfig config;
+  config.limit = atoi(args[4]);
+  for (int i = 5; i < count; i++) {
+    string arg = args[i];
+    if (arg == "--pdb" && i + 1 < count) {
+      config.pdbPath = args[++i];
+    } else if (arg == "--plan-cache" && i + 1 < count) {
+      config.cachePath = args[++i];
+    } else if (readSolverOption(count, args, i, config.options) <= 0) {
+      return 2;
+    }
+  }
+  BenchResult result = runInstance(atoi(args[0]), atoi(args[1]), atoi(args[2]), (unsigned int)atol(args[3]), config);
+  return fwrite(&result, sizeof(result), 1, stdout) == 1 && fflush(stdout) == 0 ? 0 : 1;
+}
+
+
+// Writes the CSV header, JSON lines need none
+void writeHeader(ostream& out, bool json) {
+  if (!json) {
+    out << "solver,size,nums,seed,type,goals,solved,length,nodes,time_ms,nodes_per_sec,peak_rss_kb" << endl;
+  }
+}
+
+
+// Writes one result as a CSV row or a JSON line
+void writeResult(ostream& out, bool json, BenchResult& result) {
+  long rate = result.millis > 0 ? (long)(result.nodes / (result.millis / 1000.0)) : 0;
+  string type = result.conjunctive ? "conjunctive" : "disjunctive";
+
+  if (json) {
+    out << "{\"solver\":\"" << STRATEGY_KEYS[result.strategy] << "\""
+        << ",\"size\":" << result.size
+        << ",\"nums\":" << result.nums
+        << ",\"seed\":" << result.seed
+        << ",\"type\":\"" << type << "\""
+        << ",\"goals\":" << result.goals
+        << ",\"solved\":" << (result.solved ? "true" : "false")
+        << ",\"length\":" << result.length
+        << ",\"nodes\":" << result.nodes
+        << ",\"time_ms\":" << result.millis
+        << ",\"nodes_per_sec\":" << rate
+        << ",\"peak_rss_kb\":" << result.peakKB << "}" << endl;
+  } else {
+    out << STRATEGY_KEYS[result.strategy] << "," << result.size << "," << result.nums << ","
+        << result.seed << "," << type << "," << result.goals << ","
+        << (result.solved ? 1 : 0) << "," << result.length << "," << result.nodes << ","
+        << result.millis << "," << rate << "," << result.peakKB << endl;
+  }
+}
+
+
+// Reads a comma separated list of solver names into `strategies`
+// Returns false and complains if a name is unknown
+bool parseSolvers(string list, vector<int>& strategies) {
+  stringstream names(list);
+  string name;
+  while (getline(names, name, ',')) {
+    int strategy = -1;
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+      if (STRATEGY_KEYS[i] == name) {
+        strategy = i;
+      }
+    }
+    if (strategy < 0) {
+      cerr << "Unknown solver: " << name << endl;
+      return false;
+    }
+    strategies.push_back(strategy);
+  }
+  return true;
+}
@@ -0,0 +1,205 @@
+#include <vector>
+#include <list>
+#include <atomic>
+#include <climits>
+#include <stdint.h>
+
+#include "state.h"
+#include "action.h"
+#include "moveList.h"
+#include "arena.h"
+#include "searchStats.h"
+
+using namespace std;
+
+#ifndef bidirectionalSearch_H
+#define bidirectionalSearch_H
+
+
+// Most states the two sides may hold between them before the search gives up,
+// a few hundred MB on the largest boards. Breadth first search grows with the
+// branching factor to half the plan length, where A* and IDA* are held back
+// by the move bound, so past this it is left to them.
+const size_t BIDIRECTIONAL_MAX_STATES = 1 << 19;
+
+
+// How one side of the bidirectional search first reached a state
+struct MeetLink {
+    uint64_t parent; // Key of the state it was reached from, its own key for the root
+    Action act; // The action that was taken from the parent
+    int depth; // The number of actions from the side's root
+};
+
+
+// Breadth first search from the start board and the goal board at once
+// Used when the goals name the whole board, so the board to reach is known.
+// Every action can be reversed by the opposite action, so the goal side
+// searches with the same moves as the start side. Each step expands the
+// whole deepest level of the side with the smaller frontier, and the sides
+// meet on the Zobrist key of a state both have reached. Once a level meets
+// the plan through the meeting state is of minimum length, like A*'s, while
+// each side only goes about half as deep.
+// The states and tables are held in `arena`, which must not be released
+// until the search is gone. The search stops once the sides hold
+// BIDIRECTIONAL_MAX_STATES states, see wasCut.
+class BidirectionalSearch {
+  State* start;
+  State* target;
+  Arena* arena;
+  SearchStats& stats;
+  ProgressCallback& progress;
+  long progressInterval;
+  atomic<bool>* stopFlag; // Set by another thread to abandon the search, may be NULL
+
+  // Every state each side has reached, seen[0] is the start's side
+  ArenaMap<uint64_t, MeetLink> startSeen;
+  ArenaMap<uint64_t, MeetLink> targetSeen;
+  ArenaMap<uint64_t, MeetLink>* seen[2];
+  vector<State*> frontier[2]; // The states of each side's deepest level
+  int depth[2]; // The depth of each frontier
+  bool cut; // Whether the search stopped at BIDIRECTIONAL_MAX_STATES
+
+  void expandLevel(int side, uint64_t& meet, int& best);
+  void clearFrontier(int side);
+  bool stopRequested() {return stopFlag != NULL && stopFlag->load(memory_order_relaxed);};
+
+  public:
+    BidirectionalSearch(
+      State* s, State* t, Arena* a, SearchStats& st, ProgressCallback& p, long interval, atomic<bool>* stop
+    );
+    bool search(int maxDepth, list<Action>& plan);
+    // Whether the last search gave up on memory rather than searched every
+    // plan up to its limit, another search must then decide
+    bool wasCut() {return cut;};
+    ~BidirectionalSearch();
+};
+
+
+// `s` is the start board and `t` the board to reach, neither is changed or freed
+BidirectionalSearch::BidirectionalSearch(
+    State* s, State* t, Arena* a, SearchStats& st, ProgressCallback& p, long interval, atomic<bool>* stop
+) :
+    start(s), target(t), arena(a), stats(st), progress(p), progressInterval(interval), stopFlag(stop),
+    startSeen(0, hash<uint64_t>(), equal_to<uint64_t>(), a), targetSeen(0, hash<uint64_t>(), equal_to<uint64_t>(), a) {
+    seen[0] = &startSeen;
+    seen[1] = &targetSeen;
+    depth[0] = 0;
+    depth[1] = 0;
+    cut = false;
+}
+
+
+// Searches for a plan of at most `maxDepth` actions from the start board to
+// the target board
+// On success the plan is appended to `plan`
+bool BidirectionalSearch::search(int maxDepth, list<Action>& plan) {
+    State* roots[2] = {start, target};
+    for (int side = 0; side < 2; side++) {
+        MeetLink root = {roots[side]->getHash(), Action(), 0};
+        (*seen[side])[roots[side]->getHash()] = root;
+        frontier[side].push_back(new (arena->allocate(sizeof(State))) State(roots[side], arena));
+    }
+    if (start->getHash() == target->getHash()) {
+        return true;
+    }
+
+    uint64_t meet = 0;
+    int best = INT_MAX;
+    while (best == INT_MAX && !cut && depth[0] + depth[1] < maxDepth && !stopRequested()) {
+        // Grow the side with less to expand
+        int side = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+        if (frontier[side].empty()) {
+            break;
+        }
+        expandLevel(side, meet, best);
+    }
+    if (best == INT_MAX) {
+        return false;
+    }
+
+    // The start side's links lead back from the meeting state to the start
+    list<Action> path;
+    for (uint64_t key = meet; key != start->getHash(); ) {
+        MeetLink& link = startSeen[key];
+        path.push_front(link.act);
+        key = link.parent;
+    }
+    // The target side's lead on to the target, each taken in reverse
+    for (uint64_t key = meet; key != target->getHash(); ) {
+        MeetLink& link = targetSeen[key];
+        path.push_back(Action(link.act.getToCol(), link.act.getFromCol()));
+        key = link.parent;
+    }
+    plan.splice(plan.end(), path);
+    return true;
+}
+
+
+// Expands every state of one side's frontier, replacing it with the next level
+// The first state the other side has reached joins the two searches, `best`
+// and `meet` are set to the length of the plan through it and its key
+// No plan was shorter than the two frontiers' depths added up or the sides
+// would have met already, so every meeting in this level gives the same
+// length and the rest of the level is not needed
+// The level is left unfinished, with `cut` set, when the sides grow to
+// BIDIRECTIONAL_MAX_STATES
+void BidirectionalSearch::expandLevel(int side, uint64_t& meet, int& best) {
+    ArenaMap<uint64_t, MeetLink>& mine = *seen[side];
+    ArenaMap<uint64_t, MeetLink>& other = *seen[1 - side];
+    vector<State*> next;
+    MoveList allActs;
+    for (vector<State*>::iterator i = frontier[side].begin(); i != frontier[side].end() && best == INT_MAX && !cut; i++) {
+        State* node = *i;
+        uint64_t key = node->getHash();
+        allActs.clear();
+        node->getPossibleMoves(allActs);
+        countExpansion(stats, depth[side], allActs.size(), progress, progressInterval);
+        for (Action* a = allActs.begin(); a != allActs.end(); a++) {
+            uint64_t childKey = node->getHashAfter(*a);
+            bool exists = mine.find(childKey) != mine.end();
+            if (exists) {
+                stats.tableHits++;
+                continue;
+            }
+            stats.tableMisses++;
+            MeetLink link = {key, *a, depth[side] + 1};
+            mine[childKey] = link;
+            ArenaMap<uint64_t, MeetLink>::iterator found = other.find(childKey);
+            if (found != other.end()) {
+                best = depth[side] + 1 + found->second.depth;
+                meet = childKey;
+                break;
+            }
+            node->performAction(*a);
+            next.push_back(new (arena->allocate(sizeof(State))) State(node, arena));
+            node->reverseAction(*a);
+            if (startSeen.size() + targetSeen.size() >= BIDIRECTIONAL_MAX_STATES) {
+                cut = true;
+                break;
+            }
+        }
+    }
+    clearFrontier(side);
+    frontier[side].swap(next);
+    depth[side]++;
+    size_t entries = startSeen.size() + targetSeen.size();
+    stats.peakTableEntries = entries > stats.peakTableEntries ? entries : stats.peakTableEntries;
+}
+
+
+// Frees the states of one side's frontier
+void BidirectionalSearch::clearFrontier(int side) {
+    for (vector<State*>::iterator i = frontier[side].begin(); i != frontier[side].end(); i++) {
+        arena->destroy(*i);
+    }
+    frontier[side].clear();
+}
+
+
+BidirectionalSearch::~BidirectionalSearch() {
+    clearFrontier(0);
+    clearFrontier(1);
+}
+
+
+#endif
@@ -0,0 +1,158 @@
+#include <vector>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "constants.h"
+#include "action.h"
+#include "moveList.h"
+#include "state.h"
+
+using namespace std;
+
+#ifndef bitState_H
+#define bitState_H
+
+
+// Index of the lowest set bit of x, which must not be zero
+inline int lowestBit(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+
+// A board of size N held in one 64-bit word, for boards of up to 4x4
+// (BIT_STATE_MAX_SIZE) with at most 15 tiles (BIT_STATE_MAX_TILES)
+// Cells are numbered like State (col * N + row) and cell c holds a 4-bit tile
+// id in bits 4c to 4c + 3. An occupancy mask with one bit per cell gives the
+// column heights: the tiles of a column always sit in one run from the
+// bottom, so the height is the first free bit. A second word is the tile
+// index, it holds the 4-bit cell of every tile. Every query is a shift, a
+// mask or a bit scan, and the board word is the key, so two boards have the
+// same key exactly when they are the same.
+template<int N>
+class BitState {
+  static_assert(N <= BIT_STATE_MAX_SIZE, "the board does not fit in one word");
+
+  uint64_t board;
+  uint64_t positions; // Cell of tile t in bits 4t to 4t + 3, tile 0 unused
+  uint32_t occupied;
+  int nums;
+
+  static uint32_t columnBits() {return (1u << N) - 1;};
+  static uint32_t bottomBits();
+  int tileAt(int cell) {return (int)(board >> (cell * 4)) & 15;};
+  void pushToCol(int val, int col);
+  int popFromCol(int col);
+
+  public:
+    typedef uint64_t Key;
+
+    BitState() : board(0), positions(0), occupied(0), nums(0) {};
+    BitState(State* s);
+    int getSize() {return N;};
+    int getNums() {return nums;};
+    int at(int row, int col) {return tileAt(col * N + row);};
+    int getHeight(int col) {return lowestBit(~((occupied >> (col * N)) & columnBits()));};
+    void find(int num, int& x, int& y);
+    int topTile(int col) {return getHeight(col) == 0 ? 0 : tileAt(col * N + getHeight(col) - 1);};
+    void performAction(Action& a) {pushToCol(popFromCol(a.getFromCol()), a.getToCol());};
+    void reverseAction(Action& a) {pushToCol(popFromCol(a.getToCol()), a.getFromCol());};
+    void getPossibleMoves(MoveList& actionList);
+    Key getKey() {return board;};
+};
+
+
+// A mask with the bottom cell of every column set
+template<int N>
+uint32_t BitState<N>::bottomBits() {
+    uint32_t bits = 0;
+    for (int col = 0; col < N; col++) {
+        bits |= 1u << (col * N);
+    }
+    return bits;
+}
+
+
+// Copies a board of size N out of a State, which must have at most
+// BIT_STATE_MAX_TILES tiles
+template<int N>
+BitState<N>::BitState(State* s) {
+    nums = s->getNums();
+    board = 0;
+    positions = 0;
+    occupied = 0;
+    for (int col = 0; col < N; col++) {
+        for (int row = 0; row < s->getHeight(col); row++) {
+            int cell = col * N + row;
+            board |= (uint64_t)s->at(row, col) << (cell * 4);
+            positions |= (uint64_t)cell << (s->at(row, col) * 4);
+            occupied |= 1u << cell;
+        }
+    }
+}
+
+
+// Finds the value `num` and puts the coordinates into x and y
+// Else x=0, y=0
+template<int N>
+void BitState<N>::find(int num, int& x, int& y) {
+    x = 0;
+    y = 0;
+    if (num > 0 && num <= nums) {
+        int cell = (int)(positions >> (num * 4)) & 15;
+        x = cell % N;
+        y = cell / N;
+    }
+}
+
+
+// Pushes a tile onto a column, the caller makes sure there is room
+template<int N>
+void BitState<N>::pushToCol(int val, int col) {
+    int cell = col * N + getHeight(col);
+    board |= (uint64_t)val << (cell * 4);
+    positions = (positions & ~((uint64_t)15 << (val * 4))) | ((uint64_t)cell << (val * 4));
+    occupied |= 1u << cell;
+}
+
+
+// Pops and returns the top tile of a column, the caller makes sure there is one
+template<int N>
+int BitState<N>::popFromCol(int col) {
+    int cell = col * N + getHeight(col) - 1;
+    int val = tileAt(cell);
+    board &= ~((uint64_t)15 << (cell * 4));
+    occupied &= ~(1u << cell);
+    return val;
+}
+
+
+// Gets all the possible moves, in the same order as State does
+// The columns with a tile are those with their bottom cell taken, and the
+// columns with room those with their top cell free
+template<int N>
+void BitState<N>::getPossibleMoves(MoveList& actionList) {
+    uint32_t bottom = bottomBits();
+    uint32_t sources = occupied & bottom;
+    uint32_t targets = ~occupied & (bottom << (N - 1));
+    while (sources != 0) {
+        int col = lowestBit(sources) / N;
+        sources &= sources - 1;
+        uint32_t others = targets & ~(1u << (col * N + N - 1));
+        while (others != 0) {
+            int otherCol = lowestBit(others) / N;
+            others &= others - 1;
+            actionList.push_back(Action(col, otherCol));
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,157 @@
+#include <vector>
+#include <stdint.h>
+
+#include "randomness.h"
+#include "bitState.h"
+#include "goalProgram.h"
+
+using namespace std;
+
+#ifndef boardAbstraction_H
+#define boardAbstraction_H
+
+
+// Keys that the optimal searches give boards which are the same as far as
+// the goals can tell
+// Two things are left out of the key. Only an atom goal names a column, and
+// only left and right neighbour goals care which columns are next to each
+// other, so with neither the columns an atom goal doesn't name can be
+// swapped around. And a tile that no goal names is only ever in the way, so
+// any two of those can be swapped; they are all keyed as the lowest of them,
+// the filler. Neither swap changes how far a board is from the goals, so
+// boards that differ only by them are given one key: the key of the board
+// with the fillers merged and then the free columns sorted by what they hold.
+// The searches still move real boards with real actions, only their tables
+// are keyed this way, so their plans need no mapping back.
+// The key is only used to skip boards, so it must not be given to a search
+// whose order depends on which column or tile is where, such as best first.
+class BoardAbstraction {
+  vector<int> freeCols; // In increasing order
+  vector<int> fillers; // Tiles no goal names, in increasing order
+  vector<int> tileClass; // The tile each tile is keyed as, by tile
+  vector<int> order; // Scratch for the sort, kept between calls
+
+  template<class S> bool columnBefore(S& s, int a, int b);
+
+  public:
+    void detect(GoalProgram& program, int size, int nums, bool columns, bool tiles);
+    void clear() {freeCols.clear(); fillers.clear(); tileClass.clear();};
+    // Whether any two columns or any two tiles can be swapped
+    bool isActive() {return freeCols.size() > 1 || fillers.size() > 1;};
+    template<class S> uint64_t canonicalKey(S& s);
+    template<int N> uint64_t canonicalKey(BitState<N>& s);
+};
+
+
+// Finds what a board of `size` with `nums` tiles can swap under the compiled
+// goals, the free columns when `columns` is set and the fillers when `tiles` is
+void BoardAbstraction::detect(GoalProgram& program, int size, int nums, bool columns, bool tiles) {
+    clear();
+    if (columns) {
+        program.getFreeColumns(size, freeCols);
+    }
+    if (tiles) {
+        program.getFillerTiles(nums, fillers);
+    }
+    tileClass.resize(nums + 1);
+    for (int tile = 0; tile <= nums; tile++) {
+        tileClass[tile] = tile;
+    }
+    for (size_t i = 1; i < fillers.size(); i++) {
+        tileClass[fillers[i]] = fillers[0];
+    }
+}
+
+
+// Whether column `a` of `s` sorts before column `b`, comparing the tiles as
+// they are keyed from the bottom up with an empty cell first
+template<class S>
+bool BoardAbstraction::columnBefore(S& s, int a, int b) {
+    int height = s.getHeight(a) > s.getHeight(b) ? s.getHeight(a) : s.getHeight(b);
+    for (int row = 0; row < height; row++) {
+        int tileA = row < s.getHeight(a) ? tileClass[s.at(row, a)] : 0;
+        int tileB = row < s.getHeight(b) ? tileClass[s.at(row, b)] : 0;
+        if (tileA != tileB) {
+            return tileA < tileB;
+        }
+    }
+    return false;
+}
+
+
+// The abstract Zobrist key of `s`, for a State or a FixedState
+// Each filler is taken out of the key and put back as the first filler, then
+// each free column's tiles are taken out where they are and put back in the
+// column they sort into, so the board itself isn't touched
+template<class S>
+uint64_t BoardAbstraction::canonicalKey(S& s) {
+    uint64_t key = s.getHash();
+    int size = s.getSize();
+    for (size_t i = 1; i < fillers.size(); i++) {
+        int row, col;
+        s.find(fillers[i], row, col);
+        int cell = col * size + row;
+        key ^= getZobrist(fillers[i], cell) ^ getZobrist(fillers[0], cell);
+    }
+
+    order = freeCols;
+    // There are only ever a few columns, so an insertion sort
+    for (size_t i = 1; i < order.size(); i++) {
+        int col = order[i];
+        size_t j = i;
+        for (; j > 0 && columnBefore(s, col, order[j - 1]); j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = col;
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        int from = order[i];
+        int to = freeCols[i];
+        if (from == to) {
+            continue;
+        }
+        for (int row = 0; row < s.getHeight(from); row++) {
+            int tile = tileClass[s.at(row, from)];
+            key ^= getZobrist(tile, from * size + row) ^ getZobrist(tile, to * size + row);
+        }
+    }
+    return key;
+}
+
+
+// The board word of `s` with the fillers merged and the free columns sorted
+// Every filler's 4 bits are set to the first filler's. A column is then a
+// run of 4 * N bits of the word, so the runs of the free columns are sorted
+// as numbers and written back in order
+template<int N>
+uint64_t BoardAbstraction::canonicalKey(BitState<N>& s) {
+    const int bits = 4 * N;
+    const uint64_t mask = (1ull << bits) - 1;
+    uint64_t board = s.getKey();
+    for (size_t i = 1; i < fillers.size(); i++) {
+        int row, col;
+        s.find(fillers[i], row, col);
+        int shift = (col * N + row) * 4;
+        board = (board & ~(15ull << shift)) | ((uint64_t)fillers[0] << shift);
+    }
+
+    uint64_t runs[N];
+    int count = (int)freeCols.size();
+    for (int i = 0; i < count; i++) {
+        int shift = freeCols[i] * bits;
+        uint64_t run = (board >> shift) & mask;
+        board &= ~(mask << shift);
+        int j = i;
+        for (; j > 0 && run < runs[j - 1]; j--) {
+            runs[j] = runs[j - 1];
+        }
+        runs[j] = run;
+    }
+    for (int i = 0; i < count; i++) {
+        board |= runs[i] << (freeCols[i] * bits);
+    }
+    return board;
+}
+
+
+#endif
@@ -10,7 +10,8 @@ class ConjunctiveGoalList : public GoalList {
   public:
     ConjunctiveGoalList() : GoalList() {};
     bool isSatisfied(State* gameState);
-    void getActionHeuristic(State* gameState, Action* act);
+    GoalList* clone();
+    bool isConjunctive() {return true;};
 };
 // Runs through the goal list to see if all of the goals are satisfied
 bool ConjunctiveGoalList::isSatisfied(State* gameState) {
@@ -23,14 +24,11 @@ bool ConjunctiveGoalList::isSatisfied(State* gameState) {
 }
 
 
-// Gets the heuristic for an action
-// Takes the net average of all the heuristics from all the goals
-void ConjunctiveGoalList::getActionHeuristic(State* newGameState, Action* act) {
-    double sum = 0.0;
-    for (list<Goal*>::iterator i = goalSet.begin(); i != goalSet.end(); i++) {
-        sum += (*i)->getHeuristic(newGameState);
-    }
-    act->setHeuristic(sum / (double)goalSet.size());
+// Makes an independent copy of the list and its goals
+GoalList* ConjunctiveGoalList::clone() {
+    GoalList* other = new ConjunctiveGoalList();
+    copyGoalsTo(other);
+    return other;
 }
 
 #endif
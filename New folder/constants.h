@@ -30,5 +30,29 @@ const char DIRECTION_CHARS[] = {'r', 'l', 'b', 'a'};
 // Add 4 to the direction and then use it as an index to get the string
 const string DIRECTION_STRS[] = {"right of", "left of", "below", "above"};
 
+// Search strategies a solver can run
+const int RANDOM_SEARCH = 0;
+const int BEST_FIRST_SEARCH = 1;
+const int A_STAR_SEARCH = 2;
+const int IDA_STAR_SEARCH = 3;
+const int PARALLEL_A_STAR_SEARCH = 4;
+const int RANDOM_WALK_SEARCH = 5;
+// Use the strategy as an index to get its name
+const string STRATEGY_NAMES[] = {"random actions", "Best-first-search", "A*", "IDA*", "parallel A* (HDA*)", "parallel random walks"};
+// Short names used to pick a strategy from the command line
+const string STRATEGY_KEYS[] = {"random", "bfs", "astar", "idastar", "hdastar", "walks"};
+const int STRATEGY_COUNT = 6;
+
+// Number of walks the parallel random walk search makes unless told otherwise
+const int DEFAULT_RANDOM_WALKS = 1024;
+
+// Largest board and most tiles that fit in a one word bitboard (4-bit tile ids)
+const int BIT_STATE_MAX_SIZE = 4;
+const int BIT_STATE_MAX_TILES = 15;
+
+// Largest board and pattern that pattern databases are built for
+const int PATTERN_MAX_SIZE = 8;
+const int PATTERN_MAX_TILES = 2;
+
 
 #endif
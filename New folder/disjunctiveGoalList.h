@@ -10,15 +10,15 @@ class DisjunctiveGoalList : public GoalList {
   public:
     DisjunctiveGoalList() : GoalList() {};
     bool isSatisfied(State* gameState);
-    void getActionHeuristic(State* gameState, Action* act);
+    void showSatisfied(State* gameState);
+    GoalList* clone();
+    bool isConjunctive() {return false;};
 };
 
 // Runs through all the goals to see if any one of them are satisfied
 bool DisjunctiveGoalList::isSatisfied(State* gameState) {
     for (list<Goal*>::iterator i = goalSet.begin(); i != goalSet.end(); i++) {
         if ((*i)->isSatisfied(gameState)) {
-            cout << "The satisfied goal is: ";
-            (*i)->showHumanReadable();
             return true;
         }
     }
@@ -26,17 +26,23 @@ bool DisjunctiveGoalList::isSatisfied(State* gameState) {
 }
 
 
-// Gets the heuristic for the action and applies it
-// Takes the net minimum of all the heuristics and hence focuses on that goal
-void DisjunctiveGoalList::getActionHeuristic(State* newGameState, Action* act) {
-    double min = 1.0;
+// Shows the first goal that is satisfied by the state
+void DisjunctiveGoalList::showSatisfied(State* gameState) {
     for (list<Goal*>::iterator i = goalSet.begin(); i != goalSet.end(); i++) {
-        double tmp = (*i)->getHeuristic(newGameState);
-        if (tmp < min) {
-            min = tmp;
+        if ((*i)->isSatisfied(gameState)) {
+            cout << "The satisfied goal is: ";
+            (*i)->showHumanReadable();
+            return;
         }
     }
-    act->setHeuristic(min);
+}
+
+
+// Makes an independent copy of the list and its goals
+GoalList* DisjunctiveGoalList::clone() {
+    GoalList* other = new DisjunctiveGoalList();
+    copyGoalsTo(other);
+    return other;
 }
 
 #endif
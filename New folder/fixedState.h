@@ -0,0 +1,126 @@
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+#include "action.h"
+#include "moveList.h"
+#include "randomness.h"
+#include "state.h"
+
+using namespace std;
+
+#ifndef fixedState_H
+#define fixedState_H
+
+
+// A board whose size is fixed when it is compiled, the solver has one for
+// every size from 3 to 8
+// It is laid out like State (cells[col * N + row], the column heights and a
+// tile index) but in fixed arrays of bytes held by value, so every loop over
+// the board has a constant trip count and a whole state is a flat copy.
+// Keys are built from the same Zobrist values as State, so a board has the
+// same key in both.
+template<int N>
+class FixedState {
+  array<uint8_t, N * N> cells;
+  array<uint8_t, N> heights;
+  array<uint8_t, N * N - N + 1> positions; // Cell of each tile, tile 0 unused
+  int nums;
+  uint64_t hash;
+
+  void pushToCol(int val, int col);
+  int popFromCol(int col);
+
+  public:
+    typedef uint64_t Key;
+
+    FixedState() : cells(), heights(), positions(), nums(0), hash(0) {};
+    FixedState(State* s);
+    int getSize() {return N;};
+    int getNums() {return nums;};
+    int at(int row, int col) {return cells[col * N + row];};
+    int getHeight(int col) {return heights[col];};
+    void find(int num, int& x, int& y);
+    int topTile(int col) {return heights[col] == 0 ? 0 : cells[col * N + heights[col] - 1];};
+    void performAction(Action& a) {pushToCol(popFromCol(a.getFromCol()), a.getToCol());};
+    void reverseAction(Action& a) {pushToCol(popFromCol(a.getToCol()), a.getFromCol());};
+    void getPossibleMoves(MoveList& actionList);
+    uint64_t getHash() {return hash;};
+    Key getKey() {return hash;};
+    uint64_t getHashAfter(Action& a);
+};
+
+
+// Copies a board of size N out of a State
+// The arrays start zeroed, so the unused slot of tile 0 is too
+template<int N>
+FixedState<N>::FixedState(State* s) : cells(), heights(), positions(), nums(s->getNums()), hash(s->getHash()) {
+    for (int col = 0; col < N; col++) {
+        heights[col] = s->getHeight(col);
+        for (int row = 0; row < N; row++) {
+            cells[col * N + row] = s->at(row, col);
+            if (s->at(row, col) != 0) {
+                positions[s->at(row, col)] = col * N + row;
+            }
+        }
+    }
+}
+
+
+// Finds the value `num` and puts the coordinates into x and y
+// Every tile is always on the board
+template<int N>
+void FixedState<N>::find(int num, int& x, int& y) {
+    x = positions[num] % N;
+    y = positions[num] / N;
+}
+
+
+// Pushes a tile onto a column, the caller makes sure there is room
+template<int N>
+void FixedState<N>::pushToCol(int val, int col) {
+    int cell = col * N + heights[col];
+    cells[cell] = val;
+    positions[val] = cell;
+    hash ^= getZobrist(val, cell);
+    heights[col]++;
+}
+
+
+// Pops and returns the top tile of a column, the caller makes sure there is one
+template<int N>
+int FixedState<N>::popFromCol(int col) {
+    heights[col]--;
+    int cell = col * N + heights[col];
+    int val = cells[cell];
+    cells[cell] = 0;
+    hash ^= getZobrist(val, cell);
+    return val;
+}
+
+
+// Gets the key the board would have after a valid action, without performing it
+template<int N>
+uint64_t FixedState<N>::getHashAfter(Action& a) {
+    int from = a.getFromCol() * N + heights[a.getFromCol()] - 1;
+    int to = a.getToCol() * N + heights[a.getToCol()];
+    return hash ^ getZobrist(cells[from], from) ^ getZobrist(cells[from], to);
+}
+
+
+// Gets all the possible moves, in the same order as State does
+template<int N>
+void FixedState<N>::getPossibleMoves(MoveList& actionList) {
+    for (int col = 0; col < N; col++) {
+        if (heights[col] != 0) {
+            for (int otherCol = 0; otherCol < N; otherCol++) {
+                if (otherCol != col && heights[otherCol] < N) {
+                    actionList.push_back(Action(col, otherCol));
+                }
+            }
+        }
+    }
+}
+
+
+#endif
@@ -16,6 +16,8 @@ class Goal {
   public:
     Goal() {};
     Goal(int a, int b, int c);
+    virtual ~Goal() {};
+    const int* getTuple() {return goalTuple;};
     string toString();
     void show();
     double linDist(int x0, int x1, int y0, int y1) {
@@ -25,6 +27,7 @@ class Goal {
     virtual bool isValid(State* gameState) = 0;
     virtual bool isSatisfied(State* gameState) = 0;
     virtual double getHeuristic(State* gameState) = 0;
+    virtual Goal* clone() = 0;
 };
 
 // Constructor sets up the tuple
@@ -13,14 +13,19 @@ class GoalList {
   protected:
     list<Goal*> goalSet;
 
+    void copyGoalsTo(GoalList* other);
+
   public:
     GoalList() {};
     void addGoal(Goal* goal);
     void showGoals();
     bool isValid(State* gameState);
+    list<Goal*>& getGoals() {return goalSet;};
+    virtual bool isConjunctive() = 0; // Whether every goal must hold rather than any one
     virtual bool isSatisfied(State* gameState) = 0;
-    virtual void getActionHeuristic(State* gameState, Action* act) = 0;
-    ~GoalList();
+    virtual void showSatisfied(State* gameState);
+    virtual GoalList* clone() = 0;
+    virtual ~GoalList();
 };
 
 // Push a goal new to the goal list
@@ -48,6 +53,19 @@ bool GoalList::isValid(State* gameState) {
 }
 
 
+// Shows which goal satisfied the list, only meaningful for lists where
+// one goal is enough
+void GoalList::showSatisfied(State*) {}
+
+
+// Adds a copy of every goal to another list so that both can be freed safely
+void GoalList::copyGoalsTo(GoalList* other) {
+    for (list<Goal*>::iterator i = goalSet.begin(); i != goalSet.end(); i++) {
+        other->addGoal((*i)->clone());
+    }
+}
+
+
 GoalList::~GoalList() {
     for (list<Goal*>::iterator i = goalSet.begin(); i != goalSet.end(); i++) {
         delete* i;
@@ -0,0 +1,537 @@
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <math.h>
+
+#include "constants.h"
+#include "action.h"
+#include "goal.h"
+#include "goalList.h"
+#include "heuristicKernel.h"
+#include "patternDatabase.h"
+
+using namespace std;
+
+#ifndef goalProgram_H
+#define goalProgram_H
+
+
+// Neighbour goals that share a direction: tiles[i] must be next to bases[i]
+struct NeighbourGroup {
+    vector<int> tiles;
+    vector<int> bases;
+};
+
+
+// A goal list compiled into flat arrays for the searches
+// The Goal classes stay the way goals are written and shown, the program is
+// what the searches evaluate: atom goals sit in one set of arrays and
+// neighbour goals in one group per direction, and every check is a plain loop
+// over them with no virtual calls or list nodes to chase.
+// Whether the goals hold and how close they are come out the same as from the
+// goals themselves, the move bounds of A* and IDA* are only worked out here.
+// The state can be a State or a FixedState since only at, find, getHeight
+// and getSize are used.
+class GoalProgram {
+  bool conjunctive; // Whether every goal must hold rather than any one
+  int goalCount;
+  vector<int> atomTiles;
+  vector<int> atomRows;
+  vector<int> atomCols;
+  NeighbourGroup neighbours[4]; // Indexed by direction + 4, like DIRECTION_STRS
+  vector<double> laneData; // Backing store of the successor lanes, kept between calls
+  PatternDatabase* patterns; // Raises the move bound when it fits the board, may be NULL
+
+  template<class S> bool atomSatisfied(S& s, int i);
+  template<class S> bool neighbourSatisfied(S& s, int direction, int tile, int base);
+  template<class S> double atomHeuristic(S& s, int i, double maxHeuristic);
+  template<class S> double neighbourHeuristic(S& s, int direction, int tile, int base);
+  template<class S> int atomBound(S& s, int i);
+  template<class S> double neighbourHeuristicAfter(S& s, Action& act, int direction, int tile, int base);
+  template<class S> bool spotNextTo(S& s, int direction, int base, int& x, int& y);
+  template<class S> int patternBound(S& s);
+
+  friend class GoalTracker;
+
+  public:
+    GoalProgram() : conjunctive(true), goalCount(0), patterns(NULL) {};
+    GoalProgram(GoalList* goals) : patterns(NULL) {compile(goals);};
+    void setPatternDatabase(PatternDatabase* db) {patterns = db;};
+    void compile(GoalList* goals);
+    int size() {return goalCount;};
+    template<class S> bool isSatisfied(S& s);
+    template<class S> double getHeuristic(S& s);
+    template<class S> void scoreActions(S& s, const double* distances, ScoredAction* moves, int count);
+    template<class S> int getMoveBound(S& s);
+    bool getPinnedBoard(int size, int nums, vector<int>& boardDef);
+    void getFreeColumns(int size, vector<int>& cols);
+    void getFillerTiles(int nums, vector<int>& tiles);
+};
+
+
+// Flattens a goal list into the program, replacing anything compiled before
+// A tuple with a negative second number is a neighbour goal
+void GoalProgram::compile(GoalList* goals) {
+    conjunctive = goals->isConjunctive();
+    goalCount = 0;
+    atomTiles.clear();
+    atomRows.clear();
+    atomCols.clear();
+    for (int d = 0; d < 4; d++) {
+        neighbours[d].tiles.clear();
+        neighbours[d].bases.clear();
+    }
+
+    for (list<Goal*>::iterator i = goals->getGoals().begin(); i != goals->getGoals().end(); i++) {
+        const int* tuple = (*i)->getTuple();
+        if (tuple[1] < 0) {
+            neighbours[tuple[1] + 4].tiles.push_back(tuple[0]);
+            neighbours[tuple[1] + 4].bases.push_back(tuple[2]);
+        }
+        else {
+            atomTiles.push_back(tuple[0]);
+            atomRows.push_back(tuple[1]);
+            atomCols.push_back(tuple[2]);
+        }
+        goalCount++;
+    }
+}
+
+
+// As AtomGoal::isSatisfied
+template<class S>
+bool GoalProgram::atomSatisfied(S& s, int i) {
+    return s.at(atomRows[i], atomCols[i]) == atomTiles[i];
+}
+
+
+// As NeighbourGoal::isSatisfied
+template<class S>
+bool GoalProgram::neighbourSatisfied(S& s, int direction, int tile, int base) {
+    int x, y;
+    s.find(base, x, y);
+    switch (direction) {
+        case ABOVE:
+            return x + 1 < s.getSize() && s.at(x + 1, y) == tile;
+        case BELOW:
+            return x - 1 >= 0 && s.at(x - 1, y) == tile;
+        case LEFT:
+            return y - 1 >= 0 && s.at(x, y - 1) == tile;
+        case RIGHT:
+            return y + 1 < s.getSize() && s.at(x, y + 1) == tile;
+    }
+    return false;
+}
+
+
+// As AtomGoal::getHeuristic
+template<class S>
+double GoalProgram::atomHeuristic(S& s, int i, double maxHeuristic) {
+    int x, y;
+    s.find(atomTiles[i], x, y);
+    // Squares of small whole numbers are exact, so this matches linDist
+    double dx = x - atomRows[i];
+    double dy = y - atomCols[i];
+    return sqrt(dx * dx + dy * dy) / maxHeuristic;
+}
+
+
+// As NeighbourGoal::getHeuristic
+template<class S>
+double GoalProgram::neighbourHeuristic(S& s, int direction, int tile, int base) {
+    int x, y, tileX, tileY;
+    s.find(base, x, y);
+    s.find(tile, tileX, tileY);
+    // The spot next to the base, it must be on the board and free
+    switch (direction) {
+        case ABOVE:
+            x++;
+            break;
+        case BELOW:
+            x--;
+            break;
+        case LEFT:
+            y--;
+            break;
+        case RIGHT:
+            y++;
+            break;
+    }
+    if (x < 0 || x >= s.getSize() || y < 0 || y >= s.getSize()) {
+        return 1.0;
+    }
+    // The cell below a tile is never free, so it is not checked
+    if (direction != BELOW && s.at(x, y) != 0) {
+        return 1.0;
+    }
+    double dx = x - tileX;
+    double dy = y - tileY;
+    return sqrt(dx * dx + dy * dy);
+}
+
+
+// Puts the cell next to `base` in `direction` into x and y
+// Returns whether that cell is on the board
+template<class S>
+bool GoalProgram::spotNextTo(S& s, int direction, int base, int& x, int& y) {
+    s.find(base, x, y);
+    switch (direction) {
+        case ABOVE:
+            x++;
+            break;
+        case BELOW:
+            x--;
+            break;
+        case LEFT:
+            y--;
+            break;
+        case RIGHT:
+            y++;
+            break;
+    }
+    return x >= 0 && x < s.getSize() && y >= 0 && y < s.getSize();
+}
+
+
+// A lower bound on the moves needed to satisfy atom goal `i`
+// Every tile counted has to move at least once, and no tile is counted twice:
+// the tile itself, the tiles stacked on top of it, and the tiles sitting at or
+// above the target cell in the target column
+template<class S>
+int GoalProgram::atomBound(S& s, int i) {
+    if (atomSatisfied(s, i)) {
+        return 0;
+    }
+    int x, y;
+    s.find(atomTiles[i], x, y);
+    int bound = s.getHeight(y) - x; // The tile and everything above it
+    if (y == atomCols[i]) {
+        // Moves only go between columns so the tile must leave and come back
+        bound++;
+    }
+    else if (s.getHeight(atomCols[i]) > atomRows[i]) {
+        // The target cell and anything above it must be cleared
+        bound += s.getHeight(atomCols[i]) - atomRows[i];
+    }
+    return bound;
+}
+
+
+// Whether every goal holds for a conjunctive list, or any one for a disjunctive one
+template<class S>
+bool GoalProgram::isSatisfied(S& s) {
+    for (int i = 0; i < (int)atomTiles.size(); i++) {
+        if (atomSatisfied(s, i) != conjunctive) {
+            return !conjunctive;
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = neighbours[d];
+        for (int i = 0; i < (int)group.tiles.size(); i++) {
+            if (neighbourSatisfied(s, d - 4, group.tiles[i], group.bases[i]) != conjunctive) {
+                return !conjunctive;
+            }
+        }
+    }
+    return conjunctive;
+}
+
+
+// Gets the heuristic of the state an action led to, the average over the
+// goals of a conjunctive list or the smallest of a disjunctive one
+template<class S>
+double GoalProgram::getHeuristic(S& s) {
+    double maxHeuristic = sqrt(2.0 * pow((double)s.getSize(), 2.0));
+    double sum = 0.0;
+    double min = 1.0;
+    for (int i = 0; i < (int)atomTiles.size(); i++) {
+        double tmp = atomHeuristic(s, i, maxHeuristic);
+        sum += tmp;
+        min = tmp < min ? tmp : min;
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = neighbours[d];
+        for (int i = 0; i < (int)group.tiles.size(); i++) {
+            double tmp = neighbourHeuristic(s, d - 4, group.tiles[i], group.bases[i]);
+            sum += tmp;
+            min = tmp < min ? tmp : min;
+        }
+    }
+    return conjunctive ? sum / (double)goalCount : min;
+}
+
+
+// As neighbourHeuristic on the board `act` leads to, without performing it
+// Only the moved tile changes places: its old cell becomes free and the cell
+// it lands on becomes taken
+template<class S>
+double GoalProgram::neighbourHeuristicAfter(S& s, Action& act, int direction, int tile, int base) {
+    int moved = s.topTile(act.getFromCol());
+    int oldRow = s.getHeight(act.getFromCol()) - 1;
+    int oldCol = act.getFromCol();
+    int newRow = s.getHeight(act.getToCol());
+    int newCol = act.getToCol();
+    int x, y, tileX, tileY;
+    s.find(base, x, y);
+    s.find(tile, tileX, tileY);
+    if (base == moved) {
+        x = newRow;
+        y = newCol;
+    }
+    if (tile == moved) {
+        tileX = newRow;
+        tileY = newCol;
+    }
+    switch (direction) {
+        case ABOVE:
+            x++;
+            break;
+        case BELOW:
+            x--;
+            break;
+        case LEFT:
+            y--;
+            break;
+        case RIGHT:
+            y++;
+            break;
+    }
+    if (x < 0 || x >= s.getSize() || y < 0 || y >= s.getSize()) {
+        return 1.0;
+    }
+    if (direction != BELOW) {
+        bool taken = (x == newRow && y == newCol) || (!(x == oldRow && y == oldCol) && s.at(x, y) != 0);
+        if (taken) {
+            return 1.0;
+        }
+    }
+    double dx = x - tileX;
+    double dy = y - tileY;
+    return sqrt(dx * dx + dy * dy);
+}
+
+
+// Sets the heuristic of every action in `moves` as getHeuristic would give it
+// on the board the action leads to, without performing any of them
+// `distances` holds the heuristic of each goal on `s`, in the order the goals
+// are evaluated (see GoalTracker). Each action moves one tile, so a goal keeps
+// its distance in every successor except those that move one of its tiles or,
+// for a neighbour goal, the tile next to its base. The successors are laid out
+// as lanes and every atom goal is done in all of them at once by the vector
+// kernel, neighbour goals are only worked out again where they changed. The
+// goals are added up in the same order as getHeuristic, so the results
+// are the same bit for bit.
+// The lanes are kept in the program, so one program must not score from two
+// threads at once.
+template<class S>
+void GoalProgram::scoreActions(S& s, const double* distances, ScoredAction* moves, int count) {
+    SuccessorLanes lanes;
+    lanes.count = count;
+    lanes.padded = (count + KERNEL_LANE_PAD - 1) / KERNEL_LANE_PAD * KERNEL_LANE_PAD;
+    laneData.assign(5 * lanes.padded, 0.0);
+    lanes.movedTile = &laneData[0];
+    lanes.newRow = lanes.movedTile + lanes.padded;
+    lanes.newCol = lanes.newRow + lanes.padded;
+    lanes.sum = lanes.newCol + lanes.padded;
+    lanes.min = lanes.sum + lanes.padded;
+    for (int k = 0; k < lanes.padded; k++) {
+        // Padding lanes move tile 0, which no goal refers to
+        if (k < count) {
+            lanes.movedTile[k] = s.topTile(moves[k].act.getFromCol());
+            lanes.newRow[k] = s.getHeight(moves[k].act.getToCol());
+            lanes.newCol[k] = moves[k].act.getToCol();
+        }
+        lanes.min[k] = 1.0;
+    }
+
+    double maxHeuristic = sqrt(2.0 * pow((double)s.getSize(), 2.0));
+    int goal = 0;
+    for (; goal < (int)atomTiles.size(); goal++) {
+        atomDistanceLanes(lanes, atomTiles[goal], distances[goal], atomRows[goal], atomCols[goal], maxHeuristic);
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = neighbours[d];
+        for (int i = 0; i < (int)group.tiles.size(); i++, goal++) {
+            int x, y;
+            bool onBoard = spotNextTo(s, d - 4, group.bases[i], x, y);
+            for (int k = 0; k < count; k++) {
+                int from = moves[k].act.getFromCol();
+                int to = moves[k].act.getToCol();
+                bool changed = lanes.movedTile[k] == group.tiles[i] || lanes.movedTile[k] == group.bases[i] ||
+                    (onBoard && ((y == from && x == s.getHeight(from) - 1) || (y == to && x == s.getHeight(to))));
+                double tmp = changed ? neighbourHeuristicAfter(s, moves[k].act, d - 4, group.tiles[i], group.bases[i]) : distances[goal];
+                lanes.sum[k] += tmp;
+                lanes.min[k] = tmp < lanes.min[k] ? tmp : lanes.min[k];
+            }
+        }
+    }
+    for (int k = 0; k < count; k++) {
+        moves[k].heuristic = conjunctive ? lanes.sum[k] / (double)goalCount : lanes.min[k];
+    }
+}
+
+
+// A lower bound on the moves left, the largest bound of a conjunctive list or
+// the smallest of a disjunctive one
+// One move can work towards several goals at once, so a sum of the bounds of
+// a conjunctive list could overestimate
+template<class S>
+int GoalProgram::getMoveBound(S& s) {
+    int bound = conjunctive ? 0 : -1;
+    for (int i = 0; i < (int)atomTiles.size(); i++) {
+        int tmp = atomBound(s, i);
+        if (conjunctive ? tmp > bound : (bound < 0 || tmp < bound)) {
+            bound = tmp;
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = neighbours[d];
+        for (int i = 0; i < (int)group.tiles.size(); i++) {
+            // Any unsatisfied neighbour goal needs at least one tile to move
+            int tmp = neighbourSatisfied(s, d - 4, group.tiles[i], group.bases[i]) ? 0 : 1;
+            if (conjunctive ? tmp > bound : (bound < 0 || tmp < bound)) {
+                bound = tmp;
+            }
+        }
+    }
+    if (conjunctive) {
+        int tmp = patternBound(s);
+        bound = tmp > bound ? tmp : bound;
+    }
+    return bound < 0 ? 0 : bound;
+}
+
+
+// The largest move count the pattern database gives for the atom goals,
+// each alone or every pair of them depending on how the database was built
+// Every goal of a conjunctive list must hold, so each count is a lower bound
+// on the moves left. Zero when there is no database for the board.
+template<class S>
+int GoalProgram::patternBound(S& s) {
+    if (patterns == NULL || !patterns->fits(s.getSize(), s.getNums())) {
+        return 0;
+    }
+    int offsets[PATTERN_MAX_SIZE];
+    int config = patterns->locate(s, offsets);
+    int count = (int)atomTiles.size();
+    int size = s.getSize();
+    int at[PATTERN_MAX_TILES];
+    int targets[PATTERN_MAX_TILES];
+    int bound = 0;
+    for (int i = 0; i < count; i++) {
+        if (atomTiles[i] < 1 || atomTiles[i] > s.getNums()) {
+            continue;
+        }
+        int x, y;
+        s.find(atomTiles[i], x, y);
+        at[0] = offsets[y] + x;
+        targets[0] = atomCols[i] * size + atomRows[i];
+        if (patterns->getTiles() == 1) {
+            int tmp = patterns->lookup(config, at, targets);
+            bound = tmp > bound ? tmp : bound;
+            continue;
+        }
+        for (int j = i + 1; j < count; j++) {
+            if (atomTiles[j] < 1 || atomTiles[j] > s.getNums() || atomTiles[j] == atomTiles[i]) {
+                continue;
+            }
+            s.find(atomTiles[j], x, y);
+            at[1] = offsets[y] + x;
+            targets[1] = atomCols[j] * size + atomRows[j];
+            int tmp = patterns->lookup(config, at, targets);
+            bound = tmp > bound ? tmp : bound;
+        }
+    }
+    return bound;
+}
+
+
+// Whether the goals name the whole board, a conjunctive list of atom goals
+// that puts every one of the `nums` tiles on a cell with the columns stacked
+// The board is then put into `boardDef` row by row from the bottom, the way
+// State takes it, and it is the only board that satisfies the goals
+bool GoalProgram::getPinnedBoard(int size, int nums, vector<int>& boardDef) {
+    if (!conjunctive || goalCount != (int)atomTiles.size()) {
+        return false;
+    }
+    boardDef.assign(size * size, 0);
+    vector<int> cells(nums + 1, -1);
+    for (int i = 0; i < (int)atomTiles.size(); i++) {
+        int tile = atomTiles[i];
+        int row = atomRows[i];
+        int col = atomCols[i];
+        if (tile < 1 || tile > nums || row < 0 || row >= size || col < 0 || col >= size) {
+            return false;
+        }
+        int cell = (row * size) + col;
+        // The same goal may be given twice, but never two places for a tile
+        // or two tiles for a place
+        if ((cells[tile] >= 0 && cells[tile] != cell) || (boardDef[cell] != 0 && boardDef[cell] != tile)) {
+            return false;
+        }
+        cells[tile] = cell;
+        boardDef[cell] = tile;
+    }
+    for (int tile = 1; tile <= nums; tile++) {
+        if (cells[tile] < 0) {
+            return false;
+        }
+    }
+    // No tile may float above a free cell
+    for (int col = 0; col < size; col++) {
+        for (int row = 1; row < size; row++) {
+            if (boardDef[(row * size) + col] != 0 && boardDef[((row - 1) * size) + col] == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+// Puts into `cols` the columns of a board of `size` that no goal tells apart
+// An atom goal pins its column, and a left or right neighbour goal makes the
+// order of every column matter, so there are none then
+void GoalProgram::getFreeColumns(int size, vector<int>& cols) {
+    cols.clear();
+    if (!neighbours[LEFT + 4].tiles.empty() || !neighbours[RIGHT + 4].tiles.empty()) {
+        return;
+    }
+    for (int col = 0; col < size; col++) {
+        if (find(atomCols.begin(), atomCols.end(), col) == atomCols.end()) {
+            cols.push_back(col);
+        }
+    }
+}
+
+
+// Puts into `tiles` the tiles from 1 to `nums` that no goal names, either as
+// the tile of an atom goal or as either tile of a neighbour goal
+void GoalProgram::getFillerTiles(int nums, vector<int>& tiles) {
+    vector<bool> named(nums + 1, false);
+    for (size_t i = 0; i < atomTiles.size(); i++) {
+        if (atomTiles[i] >= 1 && atomTiles[i] <= nums) {
+            named[atomTiles[i]] = true;
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = neighbours[d];
+        for (size_t i = 0; i < group.tiles.size(); i++) {
+            if (group.tiles[i] >= 1 && group.tiles[i] <= nums) {
+                named[group.tiles[i]] = true;
+            }
+            if (group.bases[i] >= 1 && group.bases[i] <= nums) {
+                named[group.bases[i]] = true;
+            }
+        }
+    }
+    tiles.clear();
+    for (int tile = 1; tile <= nums; tile++) {
+        if (!named[tile]) {
+            tiles.push_back(tile);
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,166 @@
+#include <vector>
+#include <math.h>
+
+#include "constants.h"
+#include "action.h"
+#include "goalProgram.h"
+
+using namespace std;
+
+#ifndef goalTracker_H
+#define goalTracker_H
+
+
+// The values one goal had before an action changed them
+struct TrackedGoal {
+    int goal;
+    double distance;
+    int bound;
+};
+
+
+// The heuristic and move bound of every goal on one board, kept up to date
+// as actions are applied to it and undone
+// An action moves one tile, so after it only the goals that refer to that
+// tile, or whose values depend on the columns or cells it left and landed in,
+// are evaluated again. The others keep their values. The best first search
+// scores its actions from the distances kept here, see
+// GoalProgram::scoreActions, and A* and IDA* take the move bound.
+class GoalTracker {
+  GoalProgram* program;
+  double maxHeuristic;
+  vector<double> distances; // Heuristic of each goal, as in GoalProgram::getHeuristic
+  vector<int> bounds; // Move bound of each goal, as in GoalProgram::getMoveBound
+  vector<TrackedGoal> saved; // Values replaced by apply, for undo
+  vector<int> marks; // Size of `saved` before each apply that is not undone
+
+  template<class S> void evaluate(S& s, int goal, int direction, int i);
+  void save(int goal);
+
+  public:
+    GoalTracker(GoalProgram* p) : program(p), maxHeuristic(0.0) {};
+    template<class S> void reset(S& s);
+    template<class S> void apply(S& s, Action& a);
+    void undo();
+    const double* getDistances() {return distances.empty() ? NULL : &distances[0];};
+    template<class S> int getMoveBound(S& s);
+};
+
+
+// Works out the values of a goal on `s`
+// `direction` is 0 for an atom goal and `i` its index among the atoms,
+// otherwise `i` is its index in the neighbour group of that direction
+template<class S>
+void GoalTracker::evaluate(S& s, int goal, int direction, int i) {
+    if (direction == 0) {
+        distances[goal] = program->atomHeuristic(s, i, maxHeuristic);
+        bounds[goal] = program->atomBound(s, i);
+    }
+    else {
+        NeighbourGroup& group = program->neighbours[direction + 4];
+        distances[goal] = program->neighbourHeuristic(s, direction, group.tiles[i], group.bases[i]);
+        bounds[goal] = program->neighbourSatisfied(s, direction, group.tiles[i], group.bases[i]) ? 0 : 1;
+    }
+}
+
+
+// Remembers the values of a goal so that undo can put them back
+void GoalTracker::save(int goal) {
+    TrackedGoal old = {goal, distances[goal], bounds[goal]};
+    saved.push_back(old);
+}
+
+
+// Evaluates every goal on `s` and forgets any earlier actions
+template<class S>
+void GoalTracker::reset(S& s) {
+    maxHeuristic = sqrt(2.0 * pow((double)s.getSize(), 2.0));
+    distances.assign(program->goalCount, 0.0);
+    bounds.assign(program->goalCount, 0);
+    saved.clear();
+    marks.clear();
+    int goal = 0;
+    for (int i = 0; i < (int)program->atomTiles.size(); i++, goal++) {
+        evaluate(s, goal, 0, i);
+    }
+    for (int d = 0; d < 4; d++) {
+        for (int i = 0; i < (int)program->neighbours[d].tiles.size(); i++, goal++) {
+            evaluate(s, goal, d - 4, i);
+        }
+    }
+}
+
+
+// Brings the values up to date after `a` has been performed on `s`
+template<class S>
+void GoalTracker::apply(S& s, Action& a) {
+    int from = a.getFromCol();
+    int to = a.getToCol();
+    int moved = s.topTile(to);
+    int oldRow = s.getHeight(from);
+    int newRow = s.getHeight(to) - 1;
+    marks.push_back(saved.size());
+
+    int goal = 0;
+    for (int i = 0; i < (int)program->atomTiles.size(); i++, goal++) {
+        // The bound counts the tiles above the goal's tile and in the goal's
+        // cell, so it changes with the heights of both of their columns
+        int x, y;
+        s.find(program->atomTiles[i], x, y);
+        int col = program->atomCols[i];
+        if (program->atomTiles[i] == moved || y == from || y == to || col == from || col == to) {
+            save(goal);
+            evaluate(s, goal, 0, i);
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        NeighbourGroup& group = program->neighbours[d];
+        for (int i = 0; i < (int)group.tiles.size(); i++, goal++) {
+            // The heuristic also asks whether the spot next to the base is free
+            int x, y;
+            bool onBoard = program->spotNextTo(s, d - 4, group.bases[i], x, y);
+            if (group.tiles[i] == moved || group.bases[i] == moved ||
+                (onBoard && ((y == from && x == oldRow) || (y == to && x == newRow)))) {
+                save(goal);
+                evaluate(s, goal, d - 4, i);
+            }
+        }
+    }
+}
+
+
+// Puts back the values from before the last action that was applied
+void GoalTracker::undo() {
+    int mark = marks.back();
+    marks.pop_back();
+    while ((int)saved.size() > mark) {
+        TrackedGoal& old = saved.back();
+        distances[old.goal] = old.distance;
+        bounds[old.goal] = old.bound;
+        saved.pop_back();
+    }
+}
+
+
+// As GoalProgram::getMoveBound on the current board, `s`
+// The pattern database looks at the whole board, so its part is worked out
+// again rather than tracked
+template<class S>
+int GoalTracker::getMoveBound(S& s) {
+    bool conjunctive = program->conjunctive;
+    int bound = conjunctive ? 0 : -1;
+    for (int goal = 0; goal < (int)bounds.size(); goal++) {
+        int tmp = bounds[goal];
+        if (conjunctive ? tmp > bound : (bound < 0 || tmp < bound)) {
+            bound = tmp;
+        }
+    }
+    if (conjunctive) {
+        int tmp = program->patternBound(s);
+        bound = tmp > bound ? tmp : bound;
+    }
+    return bound < 0 ? 0 : bound;
+}
+
+
+#endif
@@ -0,0 +1,98 @@
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEURISTIC_KERNEL_SSE2
+#endif
+
+using namespace std;
+
+#ifndef heuristicKernel_H
+#define heuristicKernel_H
+
+
+// Lanes are padded to a multiple of this so that every vector path can run
+// whole iterations
+const int KERNEL_LANE_PAD = 4;
+
+
+// The successors of one state, one lane per action
+// Every action moves a single tile, so a successor is described by the tile
+// and the cell it lands on, everything else is the parent's board. The values
+// are held as doubles so the kernel can compare and select them without
+// converting.
+struct SuccessorLanes {
+    int count; // Lanes in use, the rest up to `padded` hold no tile
+    int padded;
+    double* movedTile;
+    double* newRow;
+    double* newCol;
+    double* sum; // Running sum of the goal distances of each successor
+    double* min; // Running minimum of the goal distances of each successor
+};
+
+
+// Adds the distance of one atom goal in every successor to `sum` and `min`
+// `parentDistance` is the goal's distance on the parent's board, which is
+// also its distance in every successor that didn't move `tile`. For the ones
+// that did it is worked out from the lane's new cell with the arithmetic of
+// GoalProgram::atomHeuristic in the same order, so each lane gets the same
+// bits a scalar evaluation of the successor would.
+// Built with AVX2 (-mavx2, /arch:AVX2) four lanes are done at a time, with
+// SSE2 two, and with neither one.
+void atomDistanceLanes(
+    SuccessorLanes& lanes, double tile, double parentDistance,
+    double goalRow, double goalCol, double maxHeuristic
+) {
+#if defined(__AVX2__)
+    __m256d vTile = _mm256_set1_pd(tile);
+    __m256d vParent = _mm256_set1_pd(parentDistance);
+    __m256d vGoalRow = _mm256_set1_pd(goalRow);
+    __m256d vGoalCol = _mm256_set1_pd(goalCol);
+    __m256d vMax = _mm256_set1_pd(maxHeuristic);
+    for (int k = 0; k < lanes.padded; k += 4) {
+        __m256d moved = _mm256_cmp_pd(_mm256_loadu_pd(lanes.movedTile + k), vTile, _CMP_EQ_OQ);
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(lanes.newRow + k), vGoalRow);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(lanes.newCol + k), vGoalCol);
+        __m256d dist = _mm256_div_pd(
+            _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))), vMax
+        );
+        dist = _mm256_blendv_pd(vParent, dist, moved);
+        _mm256_storeu_pd(lanes.sum + k, _mm256_add_pd(_mm256_loadu_pd(lanes.sum + k), dist));
+        // min_pd(a, b) is a < b ? a : b, the same as the scalar comparison
+        _mm256_storeu_pd(lanes.min + k, _mm256_min_pd(dist, _mm256_loadu_pd(lanes.min + k)));
+    }
+#elif defined(HEURISTIC_KERNEL_SSE2)
+    __m128d vTile = _mm_set1_pd(tile);
+    __m128d vParent = _mm_set1_pd(parentDistance);
+    __m128d vGoalRow = _mm_set1_pd(goalRow);
+    __m128d vGoalCol = _mm_set1_pd(goalCol);
+    __m128d vMax = _mm_set1_pd(maxHeuristic);
+    for (int k = 0; k < lanes.padded; k += 2) {
+        __m128d moved = _mm_cmpeq_pd(_mm_loadu_pd(lanes.movedTile + k), vTile);
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(lanes.newRow + k), vGoalRow);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(lanes.newCol + k), vGoalCol);
+        __m128d dist = _mm_div_pd(_mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy))), vMax);
+        // SSE2 has no blend, so select with the comparison mask
+        dist = _mm_or_pd(_mm_and_pd(moved, dist), _mm_andnot_pd(moved, vParent));
+        _mm_storeu_pd(lanes.sum + k, _mm_add_pd(_mm_loadu_pd(lanes.sum + k), dist));
+        _mm_storeu_pd(lanes.min + k, _mm_min_pd(dist, _mm_loadu_pd(lanes.min + k)));
+    }
+#else
+    for (int k = 0; k < lanes.count; k++) {
+        double dist = parentDistance;
+        if (lanes.movedTile[k] == tile) {
+            double dx = lanes.newRow[k] - goalRow;
+            double dy = lanes.newCol[k] - goalCol;
+            dist = sqrt(dx * dx + dy * dy) / maxHeuristic;
+        }
+        lanes.sum[k] += dist;
+        lanes.min[k] = dist < lanes.min[k] ? dist : lanes.min[k];
+    }
+#endif
+}
+
+
+#endif
@@ -8,6 +8,8 @@ I hold a copy of this assignment that I can produce if the original is
 lost or damaged.
 **************************/
 #include <iostream>
+#include <fstream>
+#include <string>
 #include <ctime>
 #include <cstdlib>
 
@@ -20,6 +22,9 @@ lost or damaged.
 #include "neighbourGoal.h"
 #include "disjunctiveGoalList.h"
 #include "conjunctiveGoalList.h"
+#include "portfolio.h"
+#include "batch.h"
+#include "selfTest.h"
 
 
 void manualInit(State* gameState);
@@ -30,12 +35,29 @@ void getGoalTuple(int& a, int& b, int& c);
 void manualPlay();
 void randomPlay();
 void bestFirstPlay();
+void optimalPlay(int strategy);
+void portfolioPlay();
+void randomWalkPlay();
+int batchMain(int argc, char** argv);
+int batchUsage(char* program);
 
 
-int main() {
+int main(int argc, char** argv) {
   // Init random generator
   srand(time(NULL));
 
+  // Batch mode, the self test and the pattern database tool run without any
+  // prompts, any other argument is a mistake rather than a reason to leave the menu
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--batch" || arg == "--build-pdb" || arg == "--selftest") {
+      return batchMain(argc, argv);
+    }
+  }
+  if (argc > 1) {
+    return batchUsage(argv[0]);
+  }
+
   int choice = 0;
 
   cout << "--- Mini SHRDLU by Marcus Belcastro (19185398) ---" << endl << endl;
@@ -45,6 +67,11 @@ int main() {
     cout << "1. Manual game" << endl;
     cout << "2. Random game" << endl;
     cout << "3. AI game (best-first-search)" << endl;
+    cout << "4. AI game (A*, shortest plan)" << endl;
+    cout << "5. AI game (IDA*, shortest plan with low memory)" << endl;
+    cout << "6. AI game (portfolio of solvers racing on every core)" << endl;
+    cout << "7. AI game (parallel A* on every core, shortest plan)" << endl;
+    cout << "8. AI game (random walks on every core, shortest walk)" << endl;
     cout << "99. Exit" << endl;
     cout << "$ ";
     cin >> choice;
@@ -61,6 +88,21 @@ int main() {
       case 3:
         bestFirstPlay();
         break;
+      case 4:
+        optimalPlay(A_STAR_SEARCH);
+        break;
+      case 5:
+        optimalPlay(IDA_STAR_SEARCH);
+        break;
+      case 6:
+        portfolioPlay();
+        break;
+      case 7:
+        optimalPlay(PARALLEL_A_STAR_SEARCH);
+        break;
+      case 8:
+        randomWalkPlay();
+        break;
       case 99:
         cout << "Thank you for playing." << endl << endl;
         break;
@@ -265,7 +307,7 @@ void randomPlay() {
   // Specify the goals
   goal = setupGoals(board);
 
-  Solver currentGame = Solver(board, goal);
+  Solver currentGame(board, goal);
 
   board->showBoard();
 
@@ -284,11 +326,11 @@ void bestFirstPlay() {
   // Specify the goals
   goal = setupGoals(board);
 
-  Solver currentGame = Solver(board, goal);
+  Solver currentGame(board, goal);
 
   // For tweaking the maximum recursion
   int maxSteps = 0;
-  cout << "For smaller boards, lower max recursions work well. (Use max of 50)" << endl;
+  cout << "For smaller boards, lower max recursions work well." << endl;
   cout << "How many max recursions?" << endl;
   while (maxSteps < 1) {
     cout << "$ ";
@@ -299,3 +341,214 @@ void bestFirstPlay() {
 
   currentGame.BFSSolver(maxSteps);
 }
+
+
+// Play the game using A*, IDA* or parallel A* so that the plan found is as
+// short as possible
+void optimalPlay(int strategy) {
+  State* board;
+  GoalList* goal;
+
+  // Specify the board
+  board = setupBoard();
+
+  // Specify the goals
+  goal = setupGoals(board);
+
+  Solver currentGame(board, goal);
+
+  // Bound the search so that impossible goals still terminate
+  int maxSteps = 0;
+  cout << "What is the longest plan that should be considered?" << endl;
+  while (maxSteps < 1) {
+    cout << "$ ";
+    cin >> maxSteps;
+  }
+
+  board->showBoard();
+
+  switch (strategy) {
+    case A_STAR_SEARCH:
+      currentGame.AStarSolver(maxSteps);
+      break;
+    case IDA_STAR_SEARCH:
+      currentGame.IDAStarSolver(maxSteps);
+      break;
+    case PARALLEL_A_STAR_SEARCH:
+      currentGame.HDAStarSolver(maxSteps);
+      break;
+  }
+}
+
+
+// Play the game by racing several solvers and taking the first plan found
+void portfolioPlay() {
+  State* board;
+  GoalList* goal;
+
+  // Specify the board
+  board = setupBoard();
+
+  // Specify the goals
+  goal = setupGoals(board);
+
+  PortfolioSolver currentGame(board, goal);
+
+  // The shortest limit given to any solver, the others are scaled from it
+  int maxSteps = 0;
+  cout << "What is the longest plan that should be considered?" << endl;
+  while (maxSteps < 1) {
+    cout << "$ ";
+    cin >> maxSteps;
+  }
+
+  board->showBoard();
+
+  currentGame.portfolioSolver(maxSteps);
+}
+
+
+// Play the game with many random walks at once and take the shortest that wins
+void randomWalkPlay() {
+  State* board;
+  GoalList* goal;
+
+  // Specify the board
+  board = setupBoard();
+
+  // Specify the goals
+  goal = setupGoals(board);
+
+  Solver currentGame(board, goal);
+
+  // Walks are cut off at this length so that each one finishes quickly
+  int maxSteps = 0;
+  cout << "What is the longest walk that should be tried?" << endl;
+  while (maxSteps < 1) {
+    cout << "$ ";
+    cin >> maxSteps;
+  }
+
+  board->showBoard();
+
+  currentGame.randomWalkSolver(maxSteps);
+}
+
+
+// Solves problems from a file or stdin and writes the results as JSON lines
+// Usage: --batch [file] [--solver random|bfs|astar|idastar|hdastar|walks]
+//        [--limit n] [--seed n] [--pdb file] [--plan-cache file] [--table-mb n]
+//        and the switches of SOLVER_OPTIONS_USAGE
+// or --build-pdb size nums tiles file to write a pattern database for
+// boards of `size` with `nums` tiles, see PatternDatabase
+// or --selftest [--problems n] [--seed n] [--limit n] and the switches of
+// SOLVER_OPTIONS_USAGE to check the optimal searches on seeded problems,
+// see runSelfTest
+int batchMain(int argc, char** argv) {
+  string file = "";
+  bool selfTest = false;
+  int problems = 30;
+  unsigned int seed = 1; // Of the self test, which must be repeatable
+  int strategy = A_STAR_SEARCH;
+  int limit = 100;
+  PatternDatabase patterns;
+  PlanCache cache;
+  bool cached = false;
+  size_t tableBytes = DEFAULT_TABLE_BYTES;
+  SolverOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    int option;
+    if (arg == "--batch") {
+      continue;
+    } else if (arg == "--selftest") {
+      selfTest = true;
+    } else if (arg == "--problems" && i + 1 < argc) {
+      problems = atoi(argv[++i]);
+    } else if (arg == "--solver" && i + 1 < argc) {
+      string key = argv[++i];
+      strategy = -1;
+      for (int j = 0; j < STRATEGY_COUNT; j++) {
+        if (STRATEGY_KEYS[j] == key) {
+          strategy = j;
+        }
+      }
+      if (strategy < 0) {
+        cerr << "Unknown solver: " << key << endl;
+        return 2;
+      }
+    } else if (arg == "--limit" && i + 1 < argc) {
+      limit = atoi(argv[++i]);
+    } else if (arg == "--table-mb" && i + 1 < argc) {
+      // The memory budget of the best first search's table
+      int megabytes = atoi(argv[++i]);
+      if (megabytes < 1) {
+        cerr << "The table budget must be at least 1 MB" << endl;
+        return 2;
+      }
+      tableBytes = (size_t)megabytes << 20;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = atoi(argv[++i]);
+      srand(seed);
+    } else if (arg == "--pdb" && i + 1 < argc) {
+      string path = argv[++i];
+      if (!patterns.load(path)) {
+        cerr << "Could not load the pattern database " << path << endl;
+        return 2;
+      }
+    } else if (arg == "--plan-cache" && i + 1 < argc) {
+      string path = argv[++i];
+      if (!cache.open(path)) {
+        cerr << "Could not open the plan cache " << path << endl;
+        return 2;
+      }
+      cached = true;
+    } else if (arg == "--build-pdb" && i + 4 < argc) {
+      // The tool that writes the tables, nothing is solved
+      int size = atoi(argv[i + 1]);
+      int nums = atoi(argv[i + 2]);
+      int tiles = atoi(argv[i + 3]);
+      string path = argv[i + 4];
+      if (!PatternDatabase::build(size, nums, tiles, path)) {
+        cerr << "Could not build a pattern database for size " << size << ", " << nums << " tiles and patterns of " << tiles << " into " << path << endl;
+        return 2;
+      }
+      return 0;
+    } else if ((option = readSolverOption(argc, argv, i, options)) != 0) {
+      if (option < 0) {
+        return 2;
+      }
+    } else if ((arg[0] != '-' || arg == "-") && file.empty()) {
+      // A lone `-` names stdin
+      file = arg;
+    } else {
+      return batchUsage(argv[0]);
+    }
+  }
+
+  if (selfTest) {
+    return runSelfTest(cout, problems, seed, limit, options) > 0 ? 1 : 0;
+  }
+  if (file.empty() || file == "-") {
+    return runBatch(cin, cout, strategy, limit, patterns.isLoaded() ? &patterns : NULL, cached ? &cache : NULL, tableBytes, options) > 0 ? 1 : 0;
+  }
+  ifstream in(file.c_str());
+  if (!in) {
+    cerr << "Could not open " << file << endl;
+    return 2;
+  }
+  return runBatch(in, cout, strategy, limit, patterns.isLoaded() ? &patterns : NULL, cached ? &cache : NULL, tableBytes, options) > 0 ? 1 : 0;
+}
+
+
+// Prints how to run the program without the menu
+// Returns the exit code for a bad command line
+int batchUsage(char* program) {
+  cerr << "Usage: " << program << " (with no arguments for the menu)" << endl;
+  cerr << "       " << program << " --batch [file|-] [--solver random|bfs|astar|idastar|hdastar|walks] [--limit n] [--seed n] [--pdb file] [--plan-cache file] [--table-mb n]" << endl;
+  cerr << "         " << SOLVER_OPTIONS_USAGE << endl;
+  cerr << "       " << program << " --selftest [--problems n] [--seed n] [--limit n] " << SOLVER_OPTIONS_USAGE << endl;
+  cerr << "       " << program << " --build-pdb size nums tiles file" << endl;
+  return 2;
+}
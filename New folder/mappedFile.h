@@ -0,0 +1,137 @@
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifndef mappedFile_H
+#define mappedFile_H
+
+
+// A whole file mapped read only into memory
+// Pages are read as they are touched and are shared by every process that
+// maps the same file, so mapping a large file costs next to nothing up front
+class MappedFile {
+  const uint8_t* data; // NULL when nothing is mapped or the file is empty
+  size_t length;
+  bool mapped;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE fileMapping;
+#endif
+
+  public:
+    MappedFile();
+    bool map(const string& path);
+    void unmap();
+    bool isMapped() {return mapped;};
+    const uint8_t* getData() {return data;};
+    size_t getLength() {return length;};
+    ~MappedFile();
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+
+MappedFile::MappedFile() : data(NULL), length(0), mapped(false) {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    fileMapping = NULL;
+#endif
+}
+
+
+// Maps the file at `path`, replacing anything mapped before
+// Returns false when it can't be opened or mapped, an empty file maps to no data
+bool MappedFile::map(const string& path) {
+    unmap();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        unmap();
+        return false;
+    }
+    length = (size_t)size.QuadPart;
+    if (length > 0) {
+        fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        data = fileMapping == NULL ? NULL : (const uint8_t*)MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL) {
+            unmap();
+            return false;
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    length = (size_t)info.st_size;
+    if (length > 0) {
+        void* view = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        data = view == MAP_FAILED ? NULL : (const uint8_t*)view;
+    }
+    // The mapping stays valid once the file is closed
+    close(fd);
+    if (length > 0 && data == NULL) {
+        length = 0;
+        return false;
+    }
+#endif
+    mapped = true;
+    return true;
+}
+
+
+// Unmaps the file, if there is one
+void MappedFile::unmap() {
+#ifdef _WIN32
+    if (data != NULL) {
+        UnmapViewOfFile(data);
+    }
+    if (fileMapping != NULL) {
+        CloseHandle(fileMapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    file = INVALID_HANDLE_VALUE;
+    fileMapping = NULL;
+#else
+    if (data != NULL) {
+        munmap((void*)data, length);
+    }
+#endif
+    data = NULL;
+    length = 0;
+    mapped = false;
+}
+
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+
+#endif
@@ -0,0 +1,91 @@
+#include <vector>
+#include <stddef.h>
+
+#include "action.h"
+
+using namespace std;
+
+#ifndef moveList_H
+#define moveList_H
+
+
+// Moves a board of up to 8x8 can have, n * (n - 1) for a board of size n
+const int MOVE_LIST_INLINE = 8 * 7;
+
+
+// A list of moves held inside the object rather than on the heap
+// Generating the moves of a state, or keeping the ordered moves of a search
+// level, then costs no allocation at all. Boards larger than 8x8 have more
+// moves than fit inline and the list moves them to a vector once it fills up,
+// a list that is reused keeps that vector.
+template<class T>
+class MoveBuffer {
+  T inlineItems[MOVE_LIST_INLINE];
+  vector<T> spill;
+  T* items; // inlineItems until the list spills, then spill's storage
+  int count;
+
+  void grow();
+
+  public:
+    MoveBuffer() : items(inlineItems), count(0) {};
+    MoveBuffer(const MoveBuffer& other);
+    MoveBuffer& operator=(const MoveBuffer& other);
+    void clear() {count = 0;};
+    void push_back(const T& item);
+    void pop_back() {count--;};
+    int size() const {return count;};
+    bool empty() const {return count == 0;};
+    T& operator[](int i) {return items[i];};
+    T& front() {return items[0];};
+    T& back() {return items[count - 1];};
+    T* begin() {return items;};
+    T* end() {return items + count;};
+};
+
+
+typedef MoveBuffer<Action> MoveList;
+
+
+template<class T>
+MoveBuffer<T>::MoveBuffer(const MoveBuffer& other) : items(inlineItems), count(0) {
+    *this = other;
+}
+
+
+// Copies the moves, the copy keeps its own storage
+template<class T>
+MoveBuffer<T>& MoveBuffer<T>::operator=(const MoveBuffer& other) {
+    if (this != &other) {
+        clear();
+        for (int i = 0; i < other.count; i++) {
+            push_back(other.items[i]);
+        }
+    }
+    return *this;
+}
+
+
+// Makes room for one more move once the inline storage or the vector is full
+template<class T>
+void MoveBuffer<T>::grow() {
+    if (items == inlineItems) {
+        spill.assign(inlineItems, inlineItems + count);
+    }
+    spill.resize(count * 2);
+    items = &spill[0];
+}
+
+
+// Adds a move to the end of the list
+template<class T>
+void MoveBuffer<T>::push_back(const T& item) {
+    int capacity = items == inlineItems ? MOVE_LIST_INLINE : (int)spill.size();
+    if (count == capacity) {
+        grow();
+    }
+    items[count++] = item;
+}
+
+
+#endif
@@ -16,6 +16,7 @@ class NeighbourGoal : public Goal {
     bool isValid(State* gameState);
     bool isSatisfied(State* gameState);
     double getHeuristic(State* gameState);
+    Goal* clone() {return new NeighbourGoal(goalTuple[0], goalTuple[1], goalTuple[2]);};
 };
 
 
@@ -56,23 +57,22 @@ bool NeighbourGoal::isValid(State* gameState) {
 bool NeighbourGoal::isSatisfied(State* gameState) {
     // Initialise the board parameters
     int x, y, size = gameState->getSize();
-    int** tempBoard = gameState->getBoard();
     // Find the coordinates of the target number
     gameState->find(goalTuple[2], x, y);
 
     // Check which direction the neighbour is and check whether the
     // target number is equal to that cell
     if (goalTuple[1] == ABOVE && x + 1 < size) {
-        return tempBoard[x + 1][y] == goalTuple[0];
+        return gameState->at(x + 1, y) == goalTuple[0];
     }
     else if (goalTuple[1] == BELOW && x - 1 >= 0) {
-        return tempBoard[x - 1][y] == goalTuple[0];
+        return gameState->at(x - 1, y) == goalTuple[0];
     }
     else if (goalTuple[1] == LEFT && y - 1 >= 0) {
-        return tempBoard[x][y - 1] == goalTuple[0];
+        return gameState->at(x, y - 1) == goalTuple[0];
     }
     else if (goalTuple[1] == RIGHT && y + 1 < size) {
-        return tempBoard[x][y + 1] == goalTuple[0];
+        return gameState->at(x, y + 1) == goalTuple[0];
     }
 
     // Return false if the target is outside the board
@@ -86,7 +86,6 @@ bool NeighbourGoal::isSatisfied(State* gameState) {
 double NeighbourGoal::getHeuristic(State* gameState) {
     // Get the board parameters
     int x, y, goalNumX, goalNumY, size = gameState->getSize();
-    int** tempBoard = gameState->getBoard();
     double finalH = 1.0; // Set up the worst case heuristic
     // Get the coordinates of the base goal and the neighbour
     gameState->find(goalTuple[2], x, y);
@@ -95,7 +94,7 @@ double NeighbourGoal::getHeuristic(State* gameState) {
     // For the particular direction, get the linear distance from the base goal
     // to the neighbour if the space is unoccupied
     if (goalTuple[1] == ABOVE && x + 1 < size) {
-        if (tempBoard[x + 1][y] == 0) {
+        if (gameState->at(x + 1, y) == 0) {
             finalH = linDist(x + 1, goalNumX, y, goalNumY);
         }
     }
@@ -105,12 +104,12 @@ double NeighbourGoal::getHeuristic(State* gameState) {
         finalH = linDist(x - 1, goalNumX, y, goalNumY);
     }
     else if (goalTuple[1] == LEFT && y - 1 >= 0) {
-        if (tempBoard[x][y - 1] == 0) {
+        if (gameState->at(x, y - 1) == 0) {
             finalH = linDist(x, goalNumX, y - 1, goalNumY);
         }
     }
     else if (goalTuple[1] == RIGHT && y + 1 < size) {
-        if (tempBoard[x][y + 1] == 0) {
+        if (gameState->at(x, y + 1) == 0) {
             finalH = linDist(x, goalNumX, y + 1, goalNumY);
         }
     }
@@ -0,0 +1,293 @@
+#include <vector>
+#include <list>
+#include <queue>
+#include <unordered_set>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <new>
+#include <stdint.h>
+
+#include "constants.h"
+#include "state.h"
+#include "fixedState.h"
+#include "bitState.h"
+#include "action.h"
+#include "goal.h"
+#include "goalList.h"
+#include "goalProgram.h"
+#include "goalTracker.h"
+#include "searchStats.h"
+#include "arena.h"
+#include "patternDatabase.h"
+#include "boardAbstraction.h"
+
+using namespace std;
+
+#ifndef optimalSolver_H
+#define optimalSolver_H
+
+
+// A node of the A* search tree
+// Nodes refer to their parent by index so the plan can be rebuilt at the end
+template<class S>
+struct AStarNode {
+    S* state; // Built in the solve's arena, freed once it has been expanded
+    int g; // The number of actions taken to reach the node
+    int parent; // Index of the parent node, -1 for the root
+    Action act; // The action that was taken from the parent
+};
+
+
+// An entry of the A* open list, ordered by lowest f = g + h and then by
+// highest g so that deeper nodes are preferred on ties
+struct AStarEntry {
+    int f;
+    int g;
+    int index;
+
+    bool operator>(const AStarEntry& other) const {
+        return f > other.f || (f == other.f && g < other.g);
+    };
+};
+
+
+// A copy of the board `s` built in `arena`
+// Fixed-size boards are copied by value, a State's board goes in the arena too
+template<class S>
+S* copyBoard(S& s, Arena* arena) {
+    return new (arena->allocate(sizeof(S))) S(s);
+}
+
+
+// As above for the dynamic State, which has no copy by value
+inline State* copyBoard(State& s, Arena* arena) {
+    return new (arena->allocate(sizeof(State))) State(&s, arena);
+}
+
+
+// The state independent parts of OptimalSolver
+class OptimalSolverBase {
+  protected:
+    GoalProgram program;
+    GoalTracker tracker; // The goal values of the board IDA* works on in place
+    SearchStats& stats;
+    ProgressCallback& progress;
+    long progressInterval;
+    atomic<bool>* stopFlag;
+    Arena* arena; // Holds the nodes and tables of the searches
+    BoardAbstraction abstraction; // What the tables don't tell apart
+
+    bool stopRequested() {return stopFlag != NULL && stopFlag->load(memory_order_relaxed);};
+    void notePeakTable(size_t entries) {stats.peakTableEntries = entries > stats.peakTableEntries ? entries : stats.peakTableEntries;};
+
+  public:
+    OptimalSolverBase(GoalList* g, SearchStats& st, ProgressCallback& p, long interval, atomic<bool>* stop, Arena* a);
+    void setPatternDatabase(PatternDatabase* db) {program.setPatternDatabase(db);};
+    void setAbstraction(const BoardAbstraction& a) {abstraction = a;};
+};
+
+
+// A* and IDA*, the searches that find a plan of minimum length
+// `S` is the dynamic State or one compiled for the board size, a FixedState
+// or, when the board fits in one, a BitState. Each gives its key with getKey,
+// the tables are keyed by that or, when the goals leave columns or tiles free
+// to swap, by the BoardAbstraction key.
+// The goals are evaluated through a GoalProgram, so every `S` expands the same
+// nodes in the same order and finds the same plan
+template<class S>
+class OptimalSolver : public OptimalSolverBase {
+  typedef typename S::Key Key;
+
+  S root; // The board the searches start from, IDA* works on it in place
+
+  Key searchKey(S& s) {return abstraction.isActive() ? abstraction.canonicalKey(s) : s.getKey();};
+
+  bool iterativeDeepeningSearch(
+    S& node, int g, int threshold, int& nextThreshold,
+    ArenaSet<Key>& path, list<Action>& plan
+  );
+
+  public:
+    OptimalSolver(State* s, GoalList* g, SearchStats& st, ProgressCallback& p, long interval, atomic<bool>* stop, Arena* a) :
+      OptimalSolverBase(g, st, p, interval, stop, a), root(s) {};
+    bool aStarSearch(int maxDepth, list<Action>& plan);
+    bool idaStarSearch(int maxDepth, list<Action>& plan);
+};
+
+
+// `g` is only read while the solver is built, the counters go to `st`
+OptimalSolverBase::OptimalSolverBase(GoalList* g, SearchStats& st, ProgressCallback& p, long interval, atomic<bool>* stop, Arena* a) :
+    program(g), tracker(&program), stats(st), progress(p), progressInterval(interval), stopFlag(stop), arena(a) {}
+
+
+// The A* search algorithm
+// Expands nodes in order of f = g + h where h is the admissible move bound of
+// the goals, so the first winning node to be expanded has the shortest plan
+// On success the plan is appended to `plan`
+template<class S>
+bool OptimalSolver<S>::aStarSearch(int maxDepth, list<Action>& plan) {
+    vector< AStarNode<S> > nodes;
+    // Lowest g found so far for each state, boards that only differ by a
+    // swap of columns or tiles the goals don't name share one entry
+    ArenaMap<Key, int> bestG(0, hash<Key>(), equal_to<Key>(), arena);
+    priority_queue<AStarEntry, vector<AStarEntry>, greater<AStarEntry>> open;
+    MoveList allActs;
+    int goalIndex = -1;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    AStarNode<S> first = {copyBoard(root, arena), 0, -1, Action()};
+    nodes.push_back(first);
+    bestG[searchKey(root)] = 0;
+    open.push({program.getMoveBound(root), 0, 0});
+    stats.heuristicEvaluations++;
+
+    while (!open.empty() && !stopRequested()) {
+        AStarEntry current = open.top();
+        open.pop();
+        S* node = nodes[current.index].state;
+        // Skip entries that were superseded by a cheaper path to the same state
+        if (node == NULL || current.g > bestG[searchKey(*node)]) {
+            continue;
+        }
+        if (program.isSatisfied(*node)) {
+            goalIndex = current.index;
+            break;
+        }
+        if (current.g >= maxDepth) {
+            continue;
+        }
+
+        allActs.clear();
+        node->getPossibleMoves(allActs);
+        countExpansion(stats, current.g, allActs.size(), progress, progressInterval);
+        for (Action* i = allActs.begin(); i != allActs.end(); i++) {
+            node->performAction(*i);
+            Key key = searchKey(*node);
+            typename ArenaMap<Key, int>::iterator seen = bestG.find(key);
+            if (seen == bestG.end()) {
+                stats.tableMisses++;
+            }
+            else {
+                stats.tableHits++;
+            }
+            // Only queue states that are new or reached more cheaply than before
+            if (seen == bestG.end() || current.g + 1 < seen->second) {
+                bestG[key] = current.g + 1;
+                AStarNode<S> child = {copyBoard(*node, arena), current.g + 1, current.index, *i};
+                nodes.push_back(child);
+                open.push({
+                    current.g + 1 + program.getMoveBound(*node),
+                    current.g + 1,
+                    (int)nodes.size() - 1
+                });
+                stats.heuristicEvaluations++;
+            }
+            node->reverseAction(*i);
+        }
+        notePeakTable(bestG.size());
+        // The board of an expanded node is never needed again
+        arena->destroy(node);
+        nodes[current.index].state = NULL;
+    }
+    stats.searchMillis = millisSince(start);
+    start = chrono::steady_clock::now();
+
+    if (goalIndex >= 0) {
+        // Walk back up the tree to rebuild the plan in order
+        list<Action> path;
+        for (int i = goalIndex; nodes[i].parent >= 0; i = nodes[i].parent) {
+            path.push_front(nodes[i].act);
+        }
+        plan.splice(plan.end(), path);
+    }
+
+    for (typename vector< AStarNode<S> >::iterator i = nodes.begin(); i != nodes.end(); i++) {
+        arena->destroy(i->state);
+    }
+    stats.rebuildMillis = millisSince(start);
+    return goalIndex >= 0;
+}
+
+
+// Runs the passes of iterative deepening A*, raising the threshold to the
+// smallest f that was cut off until a solution is found or `maxDepth` is passed
+// On success the plan is appended to `plan`
+template<class S>
+bool OptimalSolver<S>::idaStarSearch(int maxDepth, list<Action>& plan) {
+    bool found = false;
+    tracker.reset(root);
+    int threshold = tracker.getMoveBound(root);
+    stats.heuristicEvaluations++;
+
+    while (!found && threshold <= maxDepth && !stopRequested()) {
+        int nextThreshold = INT_MAX;
+        stats.iterations++;
+        ArenaSet<Key> path(0, hash<Key>(), equal_to<Key>(), arena);
+        path.insert(searchKey(root));
+        found = iterativeDeepeningSearch(root, 0, threshold, nextThreshold, path, plan);
+        // Nothing was cut off by the threshold, so the whole space was searched
+        if (nextThreshold == INT_MAX) {
+            break;
+        }
+        threshold = nextThreshold;
+    }
+    return found;
+}
+
+
+// One bounded depth-first pass of iterative deepening A*
+// `node` is searched in place with do/undo, `g` is the number of actions taken
+// to reach it and any branch with g + h above `threshold` is cut off
+// `nextThreshold` collects the smallest f that was cut off for the next pass
+// `path` holds the states on the current branch so that cycles are skipped
+template<class S>
+bool OptimalSolver<S>::iterativeDeepeningSearch(
+    S& node, int g, int threshold, int& nextThreshold,
+    ArenaSet<Key>& path, list<Action>& plan
+) {
+    int f = g + tracker.getMoveBound(node);
+    stats.heuristicEvaluations++;
+    if (f > threshold) {
+        if (f < nextThreshold) {
+            nextThreshold = f;
+        }
+        return false;
+    }
+    if (program.isSatisfied(node)) {
+        return true;
+    }
+    if (stopRequested()) {
+        return false;
+    }
+
+    MoveList allActs;
+    node.getPossibleMoves(allActs);
+    countExpansion(stats, g, allActs.size(), progress, progressInterval);
+    notePeakTable(path.size());
+    for (Action* i = allActs.begin(); i != allActs.end(); i++) {
+        node.performAction(*i);
+        Key key = searchKey(node);
+        bool added = path.insert(key).second;
+        if (added) {
+            stats.tableMisses++;
+            plan.push_back(*i);
+            tracker.apply(node, *i);
+            if (iterativeDeepeningSearch(node, g + 1, threshold, nextThreshold, path, plan)) {
+                return true;
+            }
+            tracker.undo();
+            plan.pop_back();
+            path.erase(key);
+        }
+        else {
+            stats.tableHits++;
+        }
+        node.reverseAction(*i);
+    }
+    return false;
+}
+
+
+#endif
@@ -0,0 +1,300 @@
+#include <vector>
+#include <list>
+#include <queue>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <climits>
+#include <stdint.h>
+
+#include "state.h"
+#include "action.h"
+#include "goalList.h"
+#include "searchStats.h"
+#include "goalProgram.h"
+#include "patternDatabase.h"
+
+using namespace std;
+
+#ifndef parallelSearch_H
+#define parallelSearch_H
+
+
+// A node of the parallel search tree
+// Nodes are created by the worker that generates them and then handed to the
+// worker that owns their hash, they are only freed once the search is over
+// because children on other workers point back at them
+struct ParallelNode {
+    State* state; // Freed once the node has been expanded
+    int g; // The number of actions taken to reach the node
+    int f; // g plus the admissible move bound
+    double tieBreak; // The goal list heuristic, used to order nodes of equal f
+    ParallelNode* parent;
+    Action act; // The action that was taken from the parent
+    ParallelNode* next; // Link used while the node is in a message queue
+};
+
+
+// An entry of a worker's open list, ordered by lowest f, then by highest g,
+// then by the lowest goal list heuristic
+struct ParallelEntry {
+    ParallelNode* node;
+
+    bool operator>(const ParallelEntry& other) const {
+        if (node->f != other.node->f) {
+            return node->f > other.node->f;
+        }
+        if (node->g != other.node->g) {
+            return node->g < other.node->g;
+        }
+        return node->tieBreak > other.node->tieBreak;
+    };
+};
+
+
+// A lock-free queue that many workers can push to and only its owner pops
+// Pushing is a compare-and-swap onto a linked stack, the owner takes the
+// whole stack in one exchange so there is never any contention on popping
+class MessageQueue {
+  atomic<ParallelNode*> head;
+
+  public:
+    MessageQueue() : head(NULL) {};
+    void push(ParallelNode* node);
+    ParallelNode* takeAll();
+};
+
+
+// Pushes a node onto the queue from any thread
+void MessageQueue::push(ParallelNode* node) {
+    ParallelNode* oldHead = head.load(memory_order_relaxed);
+    do {
+        node->next = oldHead;
+    } while (!head.compare_exchange_weak(oldHead, node, memory_order_release, memory_order_relaxed));
+}
+
+
+// Takes every queued node at once, only the owner of the queue may call this
+// The nodes are linked through `next`, most recently pushed first
+ParallelNode* MessageQueue::takeAll() {
+    return head.exchange(NULL, memory_order_acquire);
+}
+
+
+// Hash distributed A* (HDA*)
+// Every state is owned by exactly one worker, picked from its Zobrist key.
+// Each worker has its own open and closed lists for the states it owns and
+// sends the successors it generates to their owners through message queues,
+// so the workers never lock each other out of their lists.
+// The search finds a plan of minimum length, like A*.
+class ParallelSearch {
+  State* rootState;
+  GoalProgram program; // The goals compiled for the workers to evaluate
+  int threads;
+  int maxDepth;
+  atomic<bool>* stopFlag; // Set by another thread to abandon the search, may be NULL
+
+  vector<MessageQueue> queues;
+  vector< vector<ParallelNode*> > ownedNodes; // Every node each worker received
+  // Nodes that have been queued or are waiting in an open list, the search is
+  // over once this drops to zero
+  atomic<long> outstanding;
+  atomic<int> bestPlanLength; // Length of the best plan found so far
+  vector<SearchStats> workerStats; // Each worker only ever touches its own
+  ParallelNode* goalNode;
+  mutex goalLock;
+
+  int ownerOf(uint64_t hash) {return (int)(hash % (uint64_t)threads);};
+  void send(ParallelNode* node);
+  void runWorker(int id);
+  bool stopRequested() {return stopFlag != NULL && stopFlag->load(memory_order_relaxed);};
+
+  public:
+    ParallelSearch(State* s, GoalList* g, int t, atomic<bool>* stop=NULL);
+    void setPatternDatabase(PatternDatabase* db) {program.setPatternDatabase(db);};
+    bool search(int depth, list<Action>& plan, State*& winningState);
+    SearchStats getStats();
+    ~ParallelSearch();
+};
+
+
+// `s` is only read during the search and `g` while the search is made,
+// neither is freed
+// `t` is the number of worker threads
+ParallelSearch::ParallelSearch(State* s, GoalList* g, int t, atomic<bool>* stop) :
+    rootState(s), program(g), threads(t > 0 ? t : 1), maxDepth(0), stopFlag(stop),
+    queues(t > 0 ? t : 1), ownedNodes(t > 0 ? t : 1), outstanding(0), bestPlanLength(INT_MAX),
+    workerStats(t > 0 ? t : 1), goalNode(NULL) {}
+
+
+// Runs the search with every worker and waits for them to finish
+// `depth` is the longest plan that will be considered
+// On success the plan is appended to `plan` and `winningState` is set to a
+// new copy of the winning board which the caller must delete
+bool ParallelSearch::search(int depth, list<Action>& plan, State*& winningState) {
+    maxDepth = depth;
+    ParallelNode* root = new ParallelNode();
+    root->state = new State(rootState);
+    root->g = 0;
+    root->f = program.getMoveBound(*rootState);
+    workerStats[0].heuristicEvaluations++;
+    root->tieBreak = 0.0;
+    root->parent = NULL;
+    send(root);
+
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&ParallelSearch::runWorker, this, i));
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+    }
+
+    if (goalNode == NULL) {
+        return false;
+    }
+    // Walk back up the tree to rebuild the plan in order
+    list<Action> path;
+    for (ParallelNode* i = goalNode; i->parent != NULL; i = i->parent) {
+        path.push_front(i->act);
+    }
+    plan.splice(plan.end(), path);
+    winningState = new State(goalNode->state);
+    return true;
+}
+
+
+// The counters of every worker added together, only valid once the search
+// has returned
+SearchStats ParallelSearch::getStats() {
+    SearchStats total;
+    for (int i = 0; i < threads; i++) {
+        total.add(workerStats[i]);
+    }
+    return total;
+}
+
+
+// Hands a node to the worker that owns its state
+void ParallelSearch::send(ParallelNode* node) {
+    outstanding.fetch_add(1, memory_order_relaxed);
+    queues[ownerOf(node->state->getHash())].push(node);
+}
+
+
+// The loop of one worker
+// The worker moves its incoming nodes into its open list, skipping states it
+// has already reached as cheaply, then expands its best node and sends each
+// successor to its owner
+void ParallelSearch::runWorker(int id) {
+    priority_queue<ParallelEntry, vector<ParallelEntry>, greater<ParallelEntry>> open;
+    unordered_map<uint64_t, int> bestG; // Lowest g found so far for each owned state
+    vector<ParallelNode*>& nodes = ownedNodes[id];
+    SearchStats& stats = workerStats[id];
+
+    while (outstanding.load(memory_order_acquire) > 0) {
+        if (stopRequested()) {
+            break;
+        }
+        // Take everything that was sent to this worker
+        for (ParallelNode* node = queues[id].takeAll(); node != NULL; ) {
+            ParallelNode* next = node->next;
+            nodes.push_back(node);
+            unordered_map<uint64_t, int>::iterator seen = bestG.find(node->state->getHash());
+            if (seen == bestG.end()) {
+                stats.tableMisses++;
+            }
+            else {
+                stats.tableHits++;
+            }
+            if (seen == bestG.end() || node->g < seen->second) {
+                bestG[node->state->getHash()] = node->g;
+                ParallelEntry entry = {node};
+                open.push(entry);
+            }
+            else {
+                // Already reached at least as cheaply, drop it
+                delete node->state;
+                node->state = NULL;
+                outstanding.fetch_sub(1, memory_order_release);
+            }
+            node = next;
+        }
+        stats.peakTableEntries = bestG.size();
+
+        if (open.empty()) {
+            this_thread::yield();
+            continue;
+        }
+
+        ParallelNode* node = open.top().node;
+        open.pop();
+        // Skip nodes that cannot beat the best plan, were superseded by a
+        // cheaper path to the same state or have no room left to grow
+        bool done = node->f >= bestPlanLength.load(memory_order_relaxed) ||
+            node->g > bestG[node->state->getHash()];
+
+        if (!done && program.isSatisfied(*node->state)) {
+            lock_guard<mutex> guard(goalLock);
+            if (node->g < bestPlanLength.load(memory_order_relaxed)) {
+                bestPlanLength = node->g;
+                goalNode = node;
+            }
+            // The winning board is kept for the caller
+            outstanding.fetch_sub(1, memory_order_release);
+            continue;
+        }
+
+        if (!done && node->g < maxDepth) {
+            MoveList allActs;
+            node->state->getPossibleMoves(allActs);
+            stats.nodesExpanded++;
+            stats.successorsGenerated += allActs.size();
+            stats.maxDepth = node->g > stats.maxDepth ? node->g : stats.maxDepth;
+            for (Action* i = allActs.begin(); i != allActs.end(); i++) {
+                node->state->performAction(*i);
+                int f = node->g + 1 + program.getMoveBound(*node->state);
+                stats.heuristicEvaluations++;
+                if (f < bestPlanLength.load(memory_order_relaxed)) {
+                    ParallelNode* child = new ParallelNode();
+                    child->state = new State(node->state);
+                    child->g = node->g + 1;
+                    child->f = f;
+                    child->tieBreak = program.getHeuristic(*child->state);
+                    stats.heuristicEvaluations++;
+                    child->parent = node;
+                    child->act = *i;
+                    send(child);
+                }
+                node->state->reverseAction(*i);
+            }
+        }
+        // The board of an expanded node is never needed again
+        delete node->state;
+        node->state = NULL;
+        // Children were counted before this node is let go, so the count
+        // can only reach zero once there is no work left anywhere
+        outstanding.fetch_sub(1, memory_order_release);
+    }
+}
+
+
+ParallelSearch::~ParallelSearch() {
+    for (int i = 0; i < threads; i++) {
+        // Nodes still sitting in a queue were never taken by their owner
+        for (ParallelNode* node = queues[i].takeAll(); node != NULL; ) {
+            ParallelNode* next = node->next;
+            delete node->state;
+            delete node;
+            node = next;
+        }
+        for (vector<ParallelNode*>::iterator j = ownedNodes[i].begin(); j != ownedNodes[i].end(); j++) {
+            delete (*j)->state;
+            delete *j;
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,396 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "mappedFile.h"
+
+using namespace std;
+
+#ifndef patternDatabase_H
+#define patternDatabase_H
+
+
+// The start of a pattern database file, the entries follow it directly
+struct PatternFileHeader {
+    char magic[4]; // PATTERN_FILE_MAGIC
+    uint32_t version;
+    uint32_t size;
+    uint32_t nums;
+    uint32_t tiles; // Tiles in each pattern
+    uint32_t configs; // Ways the columns can be filled, see PatternDatabase
+    uint64_t entries;
+};
+
+
+const char PATTERN_FILE_MAGIC[4] = {'S', 'P', 'D', 'B'};
+const uint32_t PATTERN_FILE_VERSION = 1;
+// Entry of a pattern that can't reach its cells, also past any plan limit
+const int PATTERN_UNREACHABLE = 255;
+
+
+// Exact move counts for patterns of a few tiles on boards of one size and tile count
+// The abstraction keeps which cells the pattern's tiles are in and how high
+// every column is, every other tile is a filler that can't be told apart
+// from the rest. For each way of placing the pattern on target cells, the
+// table holds the fewest moves from every abstract board to one with the
+// pattern on those cells, moving fillers included. A move in the real game
+// is a move in the abstraction, so the count is a lower bound on the moves a
+// real board needs to get those tiles onto those cells. Which tiles form the
+// pattern doesn't matter, so one table serves any goals on such boards.
+//
+// An abstract board is numbered by its config, the rank of its column
+// heights among all the ways `nums` tiles can fill the columns, and by the
+// position of each pattern tile in the order the tiles are stacked (column by
+// column from the bottom). The table is indexed by target, then config, then
+// positions, one byte per entry.
+//
+// build writes the file, the tool for it is `--build-pdb` on the command
+// line. load maps the file into memory rather than reading it, so processes
+// that use the same file share its pages and start at once.
+class PatternDatabase {
+  int size;
+  int nums;
+  int tiles;
+  int configs;
+  long positions; // Entries of each config for one target, nums to the power of tiles
+  const uint8_t* entries; // Inside the mapping, NULL when nothing is loaded
+  // rankSteps[(col * (nums + 1) + used) * (size + 1) + h] is how much a
+  // column of height h adds to the rank when `used` tiles sit to its left
+  vector<int> rankSteps;
+  MappedFile file;
+
+  void setup(int s, int n, int t);
+  long targetCount();
+  int rank(const int* heights);
+  void movePattern(const int* heights, int from, int to, const int* positions, int* moved);
+  void fillFromTarget(const int* targets, const vector<int>& heights, uint8_t* out);
+
+  public:
+    PatternDatabase();
+    static bool build(int s, int n, int t, const string& path);
+    bool load(const string& path);
+    void unload();
+    bool isLoaded() {return entries != NULL;};
+    bool fits(int s, int n) {return entries != NULL && s == size && n == nums;};
+    int getTiles() {return tiles;};
+    template<class S> int locate(S& s, int* offsets);
+    int lookup(int config, const int* at, const int* targets);
+    ~PatternDatabase();
+
+  private:
+    PatternDatabase(const PatternDatabase&);
+    PatternDatabase& operator=(const PatternDatabase&);
+};
+
+
+PatternDatabase::PatternDatabase() :
+    size(0), nums(0), tiles(0), configs(0), positions(0), entries(NULL) {}
+
+
+// Works out the ranking of the column heights for a board of size `s` with
+// `n` tiles and patterns of `t` tiles
+void PatternDatabase::setup(int s, int n, int t) {
+    size = s;
+    nums = n;
+    tiles = t;
+    positions = 1;
+    for (int j = 0; j < t; j++) {
+        positions *= n;
+    }
+    // ways[c * (n + 1) + k] is the number of ways k tiles can fill c columns
+    vector<long> ways((s + 1) * (n + 1), 0);
+    ways[0] = 1;
+    for (int c = 1; c <= s; c++) {
+        for (int k = 0; k <= n; k++) {
+            for (int h = 0; h <= s && h <= k; h++) {
+                ways[c * (n + 1) + k] += ways[(c - 1) * (n + 1) + k - h];
+            }
+        }
+    }
+    configs = (int)ways[s * (n + 1) + n];
+    // The heights are ranked in order, the first column counting the most
+    rankSteps.assign(s * (n + 1) * (s + 1), 0);
+    for (int col = 0; col < s; col++) {
+        for (int used = 0; used <= n; used++) {
+            int step = 0;
+            for (int h = 0; h <= s; h++) {
+                rankSteps[(col * (n + 1) + used) * (s + 1) + h] = step;
+                if (used + h <= n) {
+                    step += (int)ways[(s - col - 1) * (n + 1) + n - used - h];
+                }
+            }
+        }
+    }
+}
+
+
+// Number of ways to place the pattern on cells, cells to the power of tiles
+long PatternDatabase::targetCount() {
+    long count = 1;
+    for (int j = 0; j < tiles; j++) {
+        count *= size * size;
+    }
+    return count;
+}
+
+
+// The config of some column heights, which must add up to nums
+int PatternDatabase::rank(const int* heights) {
+    int r = 0;
+    int used = 0;
+    for (int col = 0; col < size; col++) {
+        r += rankSteps[(col * (nums + 1) + used) * (size + 1) + heights[col]];
+        used += heights[col];
+    }
+    return r;
+}
+
+
+// Gets the config of a board and puts the number of tiles to the left of
+// each column into `offsets`, a tile at (row, col) is then at position
+// offsets[col] + row
+template<class S>
+int PatternDatabase::locate(S& s, int* offsets) {
+    int r = 0;
+    int used = 0;
+    for (int col = 0; col < size; col++) {
+        offsets[col] = used;
+        int h = s.getHeight(col);
+        r += rankSteps[(col * (nums + 1) + used) * (size + 1) + h];
+        used += h;
+    }
+    return r;
+}
+
+
+// The fewest moves for the pattern tiles at positions `at` on a board of
+// `config` to reach the cells `targets` (col * size + row, as State numbers
+// them), PATTERN_UNREACHABLE when they never can
+int PatternDatabase::lookup(int config, const int* at, const int* targets) {
+    long position = 0;
+    long target = 0;
+    for (int j = 0; j < tiles; j++) {
+        position = position * nums + at[j];
+        target = target * size * size + targets[j];
+    }
+    return entries[((uint64_t)target * configs + config) * positions + position];
+}
+
+
+// The positions of the pattern tiles after the top tile of column `from` is
+// moved onto column `to` of a board with `heights`
+void PatternDatabase::movePattern(const int* heights, int from, int to, const int* positions, int* moved) {
+    int offsets[PATTERN_MAX_SIZE];
+    int newOffsets[PATTERN_MAX_SIZE];
+    int used = 0;
+    int newUsed = 0;
+    for (int col = 0; col < size; col++) {
+        offsets[col] = used;
+        newOffsets[col] = newUsed;
+        used += heights[col];
+        newUsed += heights[col] - (col == from ? 1 : 0) + (col == to ? 1 : 0);
+    }
+    int top = offsets[from] + heights[from] - 1;
+    for (int j = 0; j < tiles; j++) {
+        if (positions[j] == top) {
+            moved[j] = newOffsets[to] + heights[to];
+            continue;
+        }
+        int col = size - 1;
+        while (offsets[col] > positions[j]) {
+            col--;
+        }
+        moved[j] = newOffsets[col] + positions[j] - offsets[col];
+    }
+}
+
+
+// Fills the entries of one placement of the pattern, a breadth first search
+// out from every abstract board that has the pattern on `targets`
+// The moves of the abstraction can all be undone, so the distance from the
+// goal boards is also the distance to them
+// `heights` holds the heights of every config in rank order
+void PatternDatabase::fillFromTarget(const int* targets, const vector<int>& heights, uint8_t* out) {
+    long states = (long)configs * positions;
+    memset(out, PATTERN_UNREACHABLE, states);
+    for (int j = 0; j < tiles; j++) {
+        for (int k = 0; k < j; k++) {
+            if (targets[k] == targets[j]) {
+                return; // Two tiles can't share a cell
+            }
+        }
+    }
+
+    vector<uint32_t> queue;
+    for (int c = 0; c < configs; c++) {
+        const int* h = &heights[c * size];
+        long position = 0;
+        int used = 0;
+        int offsets[PATTERN_MAX_SIZE];
+        for (int col = 0; col < size; col++) {
+            offsets[col] = used;
+            used += h[col];
+        }
+        bool onBoard = true;
+        for (int j = 0; j < tiles; j++) {
+            int col = targets[j] / size;
+            int row = targets[j] % size;
+            onBoard = onBoard && row < h[col];
+            position = position * nums + offsets[col] + row;
+        }
+        if (onBoard) {
+            out[(long)c * positions + position] = 0;
+            queue.push_back((uint32_t)((long)c * positions + position));
+        }
+    }
+
+    int newHeights[PATTERN_MAX_SIZE];
+    int at[PATTERN_MAX_TILES];
+    int moved[PATTERN_MAX_TILES];
+    for (size_t next = 0; next < queue.size(); next++) {
+        long state = queue[next];
+        int c = (int)(state / positions);
+        const int* h = &heights[c * size];
+        long position = state % positions;
+        for (int j = tiles - 1; j >= 0; j--) {
+            at[j] = (int)(position % nums);
+            position /= nums;
+        }
+        for (int from = 0; from < size; from++) {
+            if (h[from] == 0) {
+                continue;
+            }
+            for (int to = 0; to < size; to++) {
+                if (to == from || h[to] == size) {
+                    continue;
+                }
+                movePattern(h, from, to, at, moved);
+                memcpy(newHeights, h, size * sizeof(int));
+                newHeights[from]--;
+                newHeights[to]++;
+                long child = 0;
+                for (int j = 0; j < tiles; j++) {
+                    child = child * nums + moved[j];
+                }
+                child += (long)rank(newHeights) * positions;
+                if (out[child] == PATTERN_UNREACHABLE && out[state] + 1 < PATTERN_UNREACHABLE) {
+                    out[child] = out[state] + 1;
+                    queue.push_back((uint32_t)child);
+                }
+            }
+        }
+    }
+}
+
+
+// Works out the table for boards of size `s` with `n` tiles and patterns of
+// `t` tiles and writes it to `path`
+// Returns false when the sizes aren't supported or the file can't be written
+bool PatternDatabase::build(int s, int n, int t, const string& path) {
+    if (s < 2 || s > PATTERN_MAX_SIZE || n < s || n > s * s - s || t < 1 || t > PATTERN_MAX_TILES) {
+        return false;
+    }
+    PatternDatabase db;
+    db.setup(s, n, t);
+    long positions = db.positions;
+    if ((long)db.configs * positions > (long)UINT32_MAX) {
+        return false;
+    }
+
+    // The heights of every config, found by counting through all of them
+    vector<int> heights;
+    vector<int> h(s, 0);
+    while (true) {
+        int total = 0;
+        for (int col = 0; col < s; col++) {
+            total += h[col];
+        }
+        if (total == n) {
+            heights.insert(heights.end(), h.begin(), h.end());
+        }
+        int col = s - 1;
+        while (col >= 0 && h[col] == s) {
+            h[col] = 0;
+            col--;
+        }
+        if (col < 0) {
+            break;
+        }
+        h[col]++;
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == NULL) {
+        return false;
+    }
+    PatternFileHeader header;
+    memcpy(header.magic, PATTERN_FILE_MAGIC, 4);
+    header.version = PATTERN_FILE_VERSION;
+    header.size = s;
+    header.nums = n;
+    header.tiles = t;
+    header.configs = db.configs;
+    header.entries = (uint64_t)db.targetCount() * db.configs * positions;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    // One placement of the pattern at a time, so only its part is in memory
+    vector<uint8_t> part((long)db.configs * positions);
+    int targets[PATTERN_MAX_TILES];
+    for (long target = 0; target < db.targetCount() && ok; target++) {
+        long rest = target;
+        for (int j = t - 1; j >= 0; j--) {
+            targets[j] = (int)(rest % (s * s));
+            rest /= s * s;
+        }
+        db.fillFromTarget(targets, heights, &part[0]);
+        ok = fwrite(&part[0], 1, part.size(), out) == part.size();
+    }
+    return fclose(out) == 0 && ok;
+}
+
+
+// Maps a file written by build into memory, replacing anything loaded before
+// Returns false when the file can't be mapped or isn't a pattern database
+bool PatternDatabase::load(const string& path) {
+    unload();
+    if (!file.map(path) || file.getLength() < sizeof(PatternFileHeader)) {
+        unload();
+        return false;
+    }
+
+    const PatternFileHeader* header = (const PatternFileHeader*)file.getData();
+    if (memcmp(header->magic, PATTERN_FILE_MAGIC, 4) != 0 || header->version != PATTERN_FILE_VERSION ||
+        header->size < 2 || header->size > (uint32_t)PATTERN_MAX_SIZE ||
+        header->tiles < 1 || header->tiles > (uint32_t)PATTERN_MAX_TILES ||
+        header->nums < header->size || header->nums > header->size * header->size - header->size) {
+        unload();
+        return false;
+    }
+    setup(header->size, header->nums, header->tiles);
+    if ((uint32_t)configs != header->configs ||
+        header->entries != (uint64_t)targetCount() * configs * positions ||
+        file.getLength() < sizeof(PatternFileHeader) + header->entries) {
+        unload();
+        return false;
+    }
+    entries = file.getData() + sizeof(PatternFileHeader);
+    return true;
+}
+
+
+// Unmaps the file, if there is one
+void PatternDatabase::unload() {
+    file.unmap();
+    entries = NULL;
+}
+
+
+PatternDatabase::~PatternDatabase() {
+    unload();
+}
+
+
+#endif
@@ -0,0 +1,427 @@
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "state.h"
+#include "action.h"
+#include "goal.h"
+#include "goalList.h"
+#include "mappedFile.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/file.h>
+#endif
+
+using namespace std;
+
+#ifndef planCache_H
+#define planCache_H
+
+
+// The start of a plan cache file, the records follow it
+struct PlanCacheHeader {
+    char magic[4]; // PLAN_CACHE_MAGIC
+    uint32_t version;
+};
+
+
+// The start of one record, followed by the board, the goals and the plan
+// The board is size * size tiles row by row from the bottom, the goals are
+// goalCount tuples of three signed bytes and the plan is planLength pairs of
+// columns, one byte each
+struct PlanRecordHeader {
+    uint32_t magic; // PLAN_RECORD_MAGIC
+    uint32_t checksum; // Of the rest of the record, a torn write fails it
+    uint64_t key;
+    uint8_t size;
+    uint8_t nums;
+    uint8_t conjunctive;
+    uint8_t optimal; // Whether the plan is known to be of minimum length
+    uint16_t goalCount;
+    uint16_t planLength;
+};
+
+
+const char PLAN_CACHE_MAGIC[4] = {'S', 'P', 'L', 'C'};
+const uint32_t PLAN_CACHE_VERSION = 1;
+const uint32_t PLAN_RECORD_MAGIC = 0x4e414c50;
+
+
+// A board and goal list in the form the cache stores and compares them
+// The goals are sorted and duplicates dropped, so lists that only differ in
+// the order they were written in are the same problem. Whether every goal or
+// any one must hold is kept apart, those are different problems.
+struct CachedProblem {
+    uint64_t key;
+    int size;
+    int nums;
+    bool conjunctive;
+    int goalCount;
+    vector<uint8_t> body; // The board then the goals, as in a record
+};
+
+
+// Plans found by earlier solves, kept in a file that is only ever appended to
+// The file is mapped into memory and the records are indexed by key when the
+// cache is opened, so a lookup is a hash probe and a compare. A stored plan
+// is only handed out for exactly the same board and goals, and only when it
+// is no longer than the limit; a search that has to find a plan of minimum
+// length only takes plans that were found by one.
+// Any number of processes may share the file. A store locks it, indexes the
+// records the others appended since this cache last looked, and appends its
+// own record at the true end of the file, so no record is ever written over.
+// A record cut short by a crash fails its checksum and is skipped. The
+// mapping is only renewed when a lookup needs a record past its end, and
+// lookups see other processes' records as of the last open or store.
+// Lookups and stores lock the cache, so solvers on several threads may share one.
+class PlanCache {
+  string path;
+  MappedFile file;
+  unordered_multimap<uint64_t, size_t> index; // Offset of every record by key
+  size_t end; // How much of the file has been indexed
+  mutex lock;
+
+  static uint32_t checksum(const uint8_t* bytes, size_t length);
+  static bool describe(State* s, GoalList* goals, CachedProblem& problem);
+  static size_t recordLength(const PlanRecordHeader& header);
+  static bool validRecord(const uint8_t* bytes, size_t available, PlanRecordHeader& header);
+  static bool lockFile(FILE* f);
+  static void unlockFile(FILE* f);
+  void indexRecords(const uint8_t* bytes, size_t length, size_t offset);
+  bool indexTail(FILE* f);
+  const uint8_t* recordAt(size_t offset, PlanRecordHeader& header);
+  bool matches(const uint8_t* record, const PlanRecordHeader& header, const CachedProblem& problem);
+
+  public:
+    PlanCache() : end(0) {};
+    bool open(const string& filePath);
+    bool lookup(State* s, GoalList* goals, bool optimal, int limit, vector<Action>& plan);
+    bool store(State* s, GoalList* goals, bool optimal, const vector<Action>& plan);
+    size_t size() {return index.size();};
+};
+
+
+// FNV-1a over some bytes
+uint32_t PlanCache::checksum(const uint8_t* bytes, size_t length) {
+    uint32_t sum = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        sum = (sum ^ bytes[i]) * 16777619u;
+    }
+    return sum;
+}
+
+
+// Puts a board and goal list into the cache's form and works out its key
+// Returns false when they don't fit in a record
+bool PlanCache::describe(State* s, GoalList* goals, CachedProblem& problem) {
+    int size = s->getSize();
+    if (size > 255 || s->getNums() > 255) {
+        return false;
+    }
+    problem.size = size;
+    problem.nums = s->getNums();
+    problem.conjunctive = goals->isConjunctive();
+    problem.body.clear();
+    for (int row = 0; row < size; row++) {
+        for (int col = 0; col < size; col++) {
+            problem.body.push_back((uint8_t)s->at(row, col));
+        }
+    }
+    vector< vector<int> > tuples;
+    for (list<Goal*>::iterator i = goals->getGoals().begin(); i != goals->getGoals().end(); i++) {
+        const int* tuple = (*i)->getTuple();
+        for (int k = 0; k < 3; k++) {
+            if (tuple[k] < -128 || tuple[k] > 127) {
+                return false;
+            }
+        }
+        tuples.push_back(vector<int>(tuple, tuple + 3));
+    }
+    sort(tuples.begin(), tuples.end());
+    tuples.erase(unique(tuples.begin(), tuples.end()), tuples.end());
+    if (tuples.size() > 65535) {
+        return false;
+    }
+    problem.goalCount = (int)tuples.size();
+    for (size_t i = 0; i < tuples.size(); i++) {
+        for (int k = 0; k < 3; k++) {
+            problem.body.push_back((uint8_t)(int8_t)tuples[i][k]);
+        }
+    }
+
+    uint64_t key = 14695981039346656037ull;
+    uint8_t shape[3] = {(uint8_t)problem.size, (uint8_t)problem.nums, (uint8_t)problem.conjunctive};
+    for (int i = 0; i < 3; i++) {
+        key = (key ^ shape[i]) * 1099511628211ull;
+    }
+    for (size_t i = 0; i < problem.body.size(); i++) {
+        key = (key ^ problem.body[i]) * 1099511628211ull;
+    }
+    problem.key = key;
+    return true;
+}
+
+
+// Bytes in a whole record with this header
+size_t PlanCache::recordLength(const PlanRecordHeader& header) {
+    return sizeof(PlanRecordHeader) + header.size * header.size + header.goalCount * 3 + header.planLength * 2;
+}
+
+
+// Whether `bytes` start with a whole, intact record, `available` bytes long at most
+// Its header is copied into `header`
+bool PlanCache::validRecord(const uint8_t* bytes, size_t available, PlanRecordHeader& header) {
+    if (available < sizeof(PlanRecordHeader)) {
+        return false;
+    }
+    // Records are packed one after another, so copy rather than cast
+    memcpy(&header, bytes, sizeof(header));
+    size_t length = recordLength(header);
+    return header.magic == PLAN_RECORD_MAGIC && available >= length &&
+        header.checksum == checksum(bytes + 8, length - 8);
+}
+
+
+// Takes the lock every process sharing the file takes before reading its
+// end or appending to it, waiting for it when another process has it
+bool PlanCache::lockFile(FILE* f) {
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    return LockFileEx((HANDLE)_get_osfhandle(_fileno(f)), LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+#else
+    return flock(fileno(f), LOCK_EX) == 0;
+#endif
+}
+
+
+// Gives the lock back
+void PlanCache::unlockFile(FILE* f) {
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    UnlockFileEx((HANDLE)_get_osfhandle(_fileno(f)), 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+    flock(fileno(f), LOCK_UN);
+#endif
+}
+
+
+// Indexes the records in `length` bytes that start `offset` bytes into the file
+// Bytes that don't start an intact record, such as a record a crash cut
+// short, are stepped over one at a time until a record starts again
+void PlanCache::indexRecords(const uint8_t* bytes, size_t length, size_t offset) {
+    size_t at = 0;
+    PlanRecordHeader header;
+    while (at < length) {
+        if (validRecord(bytes + at, length - at, header)) {
+            index.insert(make_pair(header.key, offset + at));
+            at += recordLength(header);
+        }
+        else {
+            at++;
+        }
+    }
+}
+
+
+// Indexes whatever other processes appended to the open, locked file `f`
+// since this cache last looked
+// Returns false when it couldn't be read
+bool PlanCache::indexTail(FILE* f) {
+    if (fseek(f, 0, SEEK_END) != 0) {
+        return false;
+    }
+    long length = ftell(f);
+    if (length < 0) {
+        return false;
+    }
+    if ((size_t)length > end) {
+        vector<uint8_t> tail((size_t)length - end);
+        if (fseek(f, (long)end, SEEK_SET) != 0 || fread(&tail[0], 1, tail.size(), f) != tail.size()) {
+            return false;
+        }
+        indexRecords(&tail[0], tail.size(), end);
+        end = (size_t)length;
+    }
+    return true;
+}
+
+
+// The record at `offset` of the file, mapping the file again when it was
+// appended to after it was mapped
+// Its header is copied into `header`, NULL when the record can't be read
+const uint8_t* PlanCache::recordAt(size_t offset, PlanRecordHeader& header) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (file.isMapped() && file.getLength() >= offset + sizeof(header)) {
+            memcpy(&header, file.getData() + offset, sizeof(header));
+            if (file.getLength() >= offset + recordLength(header)) {
+                return file.getData() + offset;
+            }
+        }
+        if (attempt == 0 && !file.map(path)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+
+// Whether `record` is for exactly this board and goal list
+bool PlanCache::matches(const uint8_t* record, const PlanRecordHeader& header, const CachedProblem& problem) {
+    return header.size == problem.size && header.nums == problem.nums &&
+        (header.conjunctive != 0) == problem.conjunctive && header.goalCount == problem.goalCount &&
+        memcmp(record + sizeof(PlanRecordHeader), &problem.body[0], problem.body.size()) == 0;
+}
+
+
+// Opens the cache at `filePath`, making an empty one when there is no file
+// Returns false when it can't be made or isn't a plan cache
+bool PlanCache::open(const string& filePath) {
+    lock_guard<mutex> guard(lock);
+    path = filePath;
+    index.clear();
+    end = 0;
+    file.unmap();
+    // Appending never changes what is already there, even when it isn't a cache
+    FILE* f = fopen(path.c_str(), "a+b");
+    if (f == NULL) {
+        return false;
+    }
+    bool valid = lockFile(f);
+    PlanCacheHeader header;
+    if (valid && fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0) {
+        memcpy(header.magic, PLAN_CACHE_MAGIC, 4);
+        header.version = PLAN_CACHE_VERSION;
+        valid = fwrite(&header, sizeof(header), 1, f) == 1 && fflush(f) == 0;
+    }
+    valid = valid && fseek(f, 0, SEEK_SET) == 0 && fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.magic, PLAN_CACHE_MAGIC, 4) == 0 && header.version == PLAN_CACHE_VERSION;
+    if (valid) {
+        // Index every record from the mapping rather than reading the file
+        valid = file.map(path);
+        end = sizeof(header);
+        if (valid && file.getLength() > end) {
+            indexRecords(file.getData() + end, file.getLength() - end, end);
+            end = file.getLength();
+        }
+    }
+    unlockFile(f);
+    fclose(f);
+    if (!valid) {
+        path.clear();
+        file.unmap();
+        index.clear();
+    }
+    return valid;
+}
+
+
+// Finds a stored plan for the board `s` and the goals
+// Only plans of minimum length are taken when `optimal` is set, and only
+// plans of at most `limit` actions; the shortest one found goes into `plan`
+// Returns whether there was one
+bool PlanCache::lookup(State* s, GoalList* goals, bool optimal, int limit, vector<Action>& plan) {
+    lock_guard<mutex> guard(lock);
+    CachedProblem problem;
+    if (path.empty() || !describe(s, goals, problem)) {
+        return false;
+    }
+    size_t best = 0;
+    PlanRecordHeader bestHeader = PlanRecordHeader();
+    pair<unordered_multimap<uint64_t, size_t>::iterator, unordered_multimap<uint64_t, size_t>::iterator> range =
+        index.equal_range(problem.key);
+    for (unordered_multimap<uint64_t, size_t>::iterator i = range.first; i != range.second; i++) {
+        PlanRecordHeader header;
+        const uint8_t* record = recordAt(i->second, header);
+        if (record != NULL && matches(record, header, problem) && (header.optimal || !optimal) &&
+            header.planLength <= limit && (best == 0 || header.planLength < bestHeader.planLength)) {
+            best = i->second;
+            bestHeader = header;
+        }
+    }
+    const uint8_t* record = best == 0 ? NULL : recordAt(best, bestHeader);
+    if (record == NULL) {
+        return false;
+    }
+    const uint8_t* moves = record + recordLength(bestHeader) - bestHeader.planLength * 2;
+    plan.clear();
+    for (int i = 0; i < bestHeader.planLength; i++) {
+        plan.push_back(Action(moves[2 * i], moves[2 * i + 1]));
+    }
+    return true;
+}
+
+
+// Appends the plan found for the board `s` and the goals
+// Nothing is written when the cache, with whatever other processes have
+// added to it, already has a plan for them that is as short and at least as
+// trusted
+// Returns false when the record couldn't be written
+bool PlanCache::store(State* s, GoalList* goals, bool optimal, const vector<Action>& plan) {
+    lock_guard<mutex> guard(lock);
+    CachedProblem problem;
+    if (path.empty() || !describe(s, goals, problem) || plan.size() > 65535) {
+        return false;
+    }
+
+    PlanRecordHeader header;
+    header.magic = PLAN_RECORD_MAGIC;
+    header.key = problem.key;
+    header.size = (uint8_t)problem.size;
+    header.nums = (uint8_t)problem.nums;
+    header.conjunctive = problem.conjunctive ? 1 : 0;
+    header.optimal = optimal ? 1 : 0;
+    header.goalCount = (uint16_t)problem.goalCount;
+    header.planLength = (uint16_t)plan.size();
+    vector<uint8_t> record(sizeof(header));
+    record.insert(record.end(), problem.body.begin(), problem.body.end());
+    for (size_t i = 0; i < plan.size(); i++) {
+        Action act = plan[i];
+        record.push_back((uint8_t)act.getFromCol());
+        record.push_back((uint8_t)act.getToCol());
+    }
+    header.checksum = 0;
+    memcpy(&record[0], &header, sizeof(header));
+    header.checksum = checksum(&record[8], record.size() - 8);
+    memcpy(&record[0], &header, sizeof(header));
+
+    FILE* f = fopen(path.c_str(), "a+b");
+    if (f == NULL) {
+        return false;
+    }
+    if (!lockFile(f)) {
+        fclose(f);
+        return false;
+    }
+    bool written = indexTail(f);
+    bool known = false;
+    pair<unordered_multimap<uint64_t, size_t>::iterator, unordered_multimap<uint64_t, size_t>::iterator> range =
+        index.equal_range(problem.key);
+    for (unordered_multimap<uint64_t, size_t>::iterator i = range.first; written && i != range.second && !known; i++) {
+        PlanRecordHeader existing;
+        const uint8_t* other = recordAt(i->second, existing);
+        known = other != NULL && matches(other, existing, problem) && (existing.optimal || !optimal) &&
+            existing.planLength <= plan.size();
+    }
+    if (written && !known) {
+        // Every write to a file opened for appending goes to its end
+        written = fwrite(&record[0], 1, record.size(), f) == record.size() && fflush(f) == 0;
+        if (written) {
+            index.insert(make_pair(problem.key, end));
+            end += record.size();
+        }
+    }
+    unlockFile(f);
+    return fclose(f) == 0 && written;
+}
+
+
+#endif
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "constants.h"
+#include "state.h"
+#include "action.h"
+#include "goalList.h"
+#include "solver.h"
+
+using namespace std;
+
+#ifndef portfolio_H
+#define portfolio_H
+
+
+// One entry of the portfolio, a strategy and the settings to run it with
+struct PortfolioConfig {
+    int strategy; // One of the search strategies in constants.h
+    int limit; // The steps, recursions or plan length given to the strategy
+    unsigned int seed; // Only used by random search
+};
+
+
+// Races several solver configurations against each other, one per thread
+// Every thread works on its own copy of the board and goals and the first one
+// to reach the goal tells the others to stop
+class PortfolioSolver {
+  list<Action> plan;
+  State* mainState;
+  GoalList* finalGoal;
+  vector<PortfolioConfig> configs;
+  atomic<bool> stopFlag;
+  mutex resultLock;
+  int winner; // Index of the winning config, -1 if none
+
+  void runConfig(Solver* solver, int index);
+
+  public:
+    // Garbage collection of mainState and finalGoal is handled in destructor
+    PortfolioSolver(State* s, GoalList* g) : mainState(s), finalGoal(g), stopFlag(false), winner(-1) {};
+    void addConfig(int strategy, int limit, unsigned int seed=0);
+    void addDefaultConfigs(int maxSteps, int threads);
+    bool solve();
+    void printPlan();
+    void portfolioSolver(int maxSteps=100);
+    list<Action>& getPlan() {return plan;};
+    State* getState() {return mainState;};
+    int getWinner() {return winner;};
+    PortfolioConfig& getConfig(int index) {return configs[index];};
+    ~PortfolioSolver();
+};
+
+
+// Adds a configuration to the race
+void PortfolioSolver::addConfig(int strategy, int limit, unsigned int seed) {
+    PortfolioConfig config = {strategy, limit, seed};
+    configs.push_back(config);
+}
+
+
+// Fills the portfolio with a spread of strategies, one for each of `threads`
+// threads and no more
+// A* and IDA* find the shortest plan, best-first-search is tried with a few
+// recursion limits and every remaining thread does random walks. With fewer
+// threads than that the configs at the front of the list are kept.
+void PortfolioSolver::addDefaultConfigs(int maxSteps, int threads) {
+    PortfolioConfig spread[] = {
+        {A_STAR_SEARCH, maxSteps, 0},
+        {BEST_FIRST_SEARCH, maxSteps, 0},
+        {BEST_FIRST_SEARCH, maxSteps * 4, 0},
+        {IDA_STAR_SEARCH, maxSteps, 0},
+        {BEST_FIRST_SEARCH, maxSteps * 16, 0}
+    };
+    int wanted = threads > 0 ? threads : 1;
+    for (int i = 0; i < (int)(sizeof(spread) / sizeof(spread[0])) && (int)configs.size() < wanted; i++) {
+        addConfig(spread[i].strategy, spread[i].limit, spread[i].seed);
+    }
+    for (unsigned int seed = 1; (int)configs.size() < wanted; seed++) {
+        addConfig(RANDOM_SEARCH, maxSteps * 10, seed);
+    }
+}
+
+
+// Runs every configuration on its own thread and waits for them all
+// Returns whether any of them found a solution
+bool PortfolioSolver::solve() {
+    vector<Solver*> solvers;
+    vector<thread> workers;
+    stopFlag = false;
+    // Copy the board and goals up front, the winner replaces mainState
+    // while the other threads may still be running
+    for (int i = 0; i < (int)configs.size(); i++) {
+        Solver* solver = new Solver(new State(mainState), finalGoal->clone());
+        solver->setSeed(configs[i].seed);
+        solver->setStopFlag(&stopFlag);
+        solvers.push_back(solver);
+    }
+    for (int i = 0; i < (int)configs.size(); i++) {
+        workers.push_back(thread(&PortfolioSolver::runConfig, this, solvers[i], i));
+    }
+    for (int i = 0; i < (int)configs.size(); i++) {
+        workers[i].join();
+        delete solvers[i];
+    }
+    return winner >= 0;
+}
+
+
+// The body of a worker thread, `solver` has its own copy of the board and goals
+// The winner copies its plan and board back before the solver is freed
+void PortfolioSolver::runConfig(Solver* solver, int index) {
+    // Only the first solver to finish may claim the win
+    if (solver->solve(configs[index].strategy, configs[index].limit) && !stopFlag.exchange(true)) {
+        lock_guard<mutex> guard(resultLock);
+        winner = index;
+        plan = solver->getPlan();
+        delete mainState;
+        mainState = new State(solver->getState());
+    }
+}
+
+
+// Races the default portfolio on every core and prints the winner
+void PortfolioSolver::portfolioSolver(int maxSteps) {
+    int threads = thread::hardware_concurrency();
+    addDefaultConfigs(maxSteps, threads > 0 ? threads : 1);
+
+    if (solve()) {
+        PortfolioConfig& config = configs[winner];
+        cout << "We found a solution using " << STRATEGY_NAMES[config.strategy];
+        cout << " (limit " << config.limit << ") in a portfolio of " << configs.size() << " solvers! Printing the plan..." << endl;
+        finalGoal->showSatisfied(mainState);
+        printPlan();
+        mainState->showBoard();
+    }
+    else {
+        cout << "No solution found :(" << endl;
+    }
+}
+
+
+void PortfolioSolver::printPlan() {
+    for (list<Action>::iterator i = plan.begin(); i != plan.end(); i++) {
+        i->showHumanReadable();
+    }
+}
+
+
+PortfolioSolver::~PortfolioSolver() {
+    delete mainState;
+    delete finalGoal;
+}
+
+
+#endif
@@ -1,11 +1,82 @@
 #ifndef randomness_H
 #define randomness_H
 
+#include <stdint.h>
+
 using namespace std;
 
 int getRand(int a, int b);
+uint64_t mix64(uint64_t x);
+uint64_t getZobrist(int tile, int cell);
+
+
+// A small fast generator (xoshiro256**) for code that needs its own stream
+// Each thread should own one, unlike rand() nothing is shared between them
+class FastRandom {
+	uint64_t s[4];
+
+	static uint64_t rotl(uint64_t x, int k) {return (x << k) | (x >> (64 - k));};
+
+  public:
+	FastRandom(uint64_t seed=0) {setSeed(seed);};
+	void setSeed(uint64_t seed);
+	uint64_t next();
+	int below(int n);
+};
+
+
 // Get a random number between two positive integers a and b (inclusive)
 int getRand(int a, int b) {
 	return rand() % (b - a + 1) + a;
 }
+
+
+// The splitmix64 finaliser, scrambles the bits of x so that nearby inputs give
+// completely unrelated outputs
+uint64_t mix64(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+
+// Gets the Zobrist key of a tile sitting in a particular cell of the board
+// The keys are derived from the pair rather than stored in a table, so they
+// are the same for every board and never need to be initialised
+uint64_t getZobrist(int tile, int cell) {
+	return mix64(((uint64_t)tile << 32) | (uint32_t)cell);
+}
+
+
+// Fills the state from a seed with splitmix64, so that nearby seeds still
+// give unrelated streams and the state is never all zero
+void FastRandom::setSeed(uint64_t seed) {
+	for (int i = 0; i < 4; i++) {
+		seed += 0x9E3779B97F4A7C15ULL;
+		s[i] = mix64(seed);
+	}
+}
+
+
+// Gets the next 64 random bits
+uint64_t FastRandom::next() {
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+
+// Gets a random number from 0 up to but not including n
+// The top bits are scaled rather than taking a remainder, which is both
+// faster and less biased
+int FastRandom::below(int n) {
+	return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+}
 #endif
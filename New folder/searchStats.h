@@ -0,0 +1,77 @@
+#include <chrono>
+#include <functional>
+#include <stddef.h>
+
+using namespace std;
+
+#ifndef searchStats_H
+#define searchStats_H
+
+
+// Counters of what one search did
+// A lookup is a hit when the state was already known to the search, which
+// depending on the strategy means its visited table, closed list or path
+struct SearchStats {
+    long nodesExpanded; // States whose actions were generated
+    long successorsGenerated; // Actions generated over all those states
+    long tableHits; // Successors that were already known and were skipped
+    long tableMisses; // Successors that were new
+    long heuristicEvaluations; // Calls to the goal heuristic or move bound
+    int maxDepth; // Longest partial plan that was expanded
+    size_t peakTableEntries; // Most states remembered at once
+    int iterations; // Passes made, only IDA* makes more than one
+    double searchMillis; // Time spent looking for a goal
+    double rebuildMillis; // Time spent rebuilding the plan and freeing the search
+    double totalMillis; // Wall time of the whole solve
+
+    SearchStats();
+    void add(const SearchStats& other);
+};
+
+
+// Called with the counters so far while a search is running
+typedef function<void(const SearchStats&)> ProgressCallback;
+
+
+SearchStats::SearchStats() :
+    nodesExpanded(0), successorsGenerated(0), tableHits(0), tableMisses(0),
+    heuristicEvaluations(0), maxDepth(0), peakTableEntries(0), iterations(0),
+    searchMillis(0.0), rebuildMillis(0.0), totalMillis(0.0) {}
+
+
+// Folds the counters of a part of the search into these ones
+// Tables of separate parts are held at the same time, so their peaks add up
+void SearchStats::add(const SearchStats& other) {
+    nodesExpanded += other.nodesExpanded;
+    successorsGenerated += other.successorsGenerated;
+    tableHits += other.tableHits;
+    tableMisses += other.tableMisses;
+    heuristicEvaluations += other.heuristicEvaluations;
+    maxDepth = other.maxDepth > maxDepth ? other.maxDepth : maxDepth;
+    peakTableEntries += other.peakTableEntries;
+    iterations = other.iterations > iterations ? other.iterations : iterations;
+}
+
+
+// Counts the expansion of a state at `depth` with `successors` actions and
+// calls `progress`, if there is one, after every `interval` expansions
+void countExpansion(SearchStats& stats, int depth, int successors, ProgressCallback& progress, long interval) {
+    stats.nodesExpanded++;
+    stats.successorsGenerated += successors;
+    if (depth > stats.maxDepth) {
+        stats.maxDepth = depth;
+    }
+    if (progress && stats.nodesExpanded % interval == 0) {
+        progress(stats);
+    }
+}
+
+
+// Milliseconds that have passed since `start`
+double millisSince(chrono::steady_clock::time_point start) {
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+
+#endif
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_set>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "constants.h"
+#include "state.h"
+#include "action.h"
+#include "moveList.h"
+#include "goal.h"
+#include "goalList.h"
+#include "atomGoal.h"
+#include "neighbourGoal.h"
+#include "conjunctiveGoalList.h"
+#include "disjunctiveGoalList.h"
+#include "randomness.h"
+#include "solverOptions.h"
+#include "solver.h"
+
+using namespace std;
+
+#ifndef selfTest_H
+#define selfTest_H
+
+
+// Self test of the optimal searches
+//
+// Seeded random problems are solved by A*, IDA* and HDA* under every switch of
+// SolverOptions turned off in turn, and each plan is checked against a plain
+// breadth first search that uses none of the searches' machinery:
+//
+//   - every solver solves exactly the problems breadth first search solves
+//     within the limit, with a plan of the same, minimum, length
+//   - every plan replays from the board to a board that meets the goals
+//   - A* and IDA* expand as many nodes on a FixedState, a BitState and the
+//     dynamic State, since all three are searched in the same order
+//
+// The problems rotate through the whole of a target board, which the
+// bidirectional search takes, a few goals of a target board, which leave
+// columns and tiles for the symmetry and filler keys to merge, and a
+// disjunction of random goals. One JSON line is written per problem and a
+// last line sums them up.
+
+// A way of running the solvers that the self test compares
+struct SelfTestVariant {
+    string name;
+    SolverOptions options;
+};
+
+
+// Kinds of problem, the problem number picks one in turn
+const int WHOLE_TARGET_PROBLEM = 0; // Every tile where a target board has it
+const int PART_TARGET_PROBLEM = 1; // Two tiles and a stacked pair of a target board
+const int EITHER_GOAL_PROBLEM = 2; // An atom goal or a neighbour goal
+const int SELF_TEST_KINDS = 3;
+
+GoalList* makeSelfTestGoals(State* board, int kind);
+vector<SelfTestVariant> getSelfTestVariants(const SolverOptions& options);
+int shortestPlanLength(State* board, GoalList* goals, int limit);
+bool replayPlan(State* board, GoalList* goals, list<Action>& plan);
+int runSelfTest(ostream& out, int problems, unsigned int seed, int limit, const SolverOptions& options);
+
+
+// Builds goals of `kind` for `board`, which the caller must delete
+// Target boards have the same tiles as `board`, so the goals they give can
+// all be met at once
+GoalList* makeSelfTestGoals(State* board, int kind) {
+    int size = board->getSize();
+    int nums = board->getNums();
+    GoalList* goals;
+    if (kind == EITHER_GOAL_PROBLEM) {
+        goals = new DisjunctiveGoalList();
+        for (int type = 0; type < 2; type++) {
+            Goal* goal = NULL;
+            // Random goals can be impossible, draw until one is valid
+            while (goal == NULL) {
+                goal = type == 0 ? (Goal*)new AtomGoal(board) : (Goal*)new NeighbourGoal(board);
+                if (!goal->isValid(board)) {
+                    delete goal;
+                    goal = NULL;
+                }
+            }
+            goals->addGoal(goal);
+        }
+        return goals;
+    }
+
+    goals = new ConjunctiveGoalList();
+    State target(size, nums);
+    if (kind == WHOLE_TARGET_PROBLEM) {
+        for (int col = 0; col < size; col++) {
+            for (int row = 0; row < target.getHeight(col); row++) {
+                goals->addGoal(new AtomGoal(target.at(row, col), row, col));
+            }
+        }
+        return goals;
+    }
+
+    int first = getRand(1, nums);
+    int second;
+    do {
+        second = getRand(1, nums);
+    } while (second == first);
+    int tiles[] = {first, second};
+    for (int i = 0; i < 2; i++) {
+        int row, col;
+        target.find(tiles[i], row, col);
+        goals->addGoal(new AtomGoal(tiles[i], row, col));
+    }
+    for (int col = 0; col < size; col++) {
+        if (target.getHeight(col) > 1) {
+            goals->addGoal(new NeighbourGoal(target.at(1, col), ABOVE, target.at(0, col)));
+            break;
+        }
+    }
+    return goals;
+}
+
+
+// The ways the solvers are run, `options` as they are given and then with
+// each switch that must not change a plan turned off, one at a time and all
+// together
+// The first three only differ in the state the searches are made on
+vector<SelfTestVariant> getSelfTestVariants(const SolverOptions& options) {
+    vector<SelfTestVariant> variants;
+    SelfTestVariant variant = {"default", options};
+    variants.push_back(variant);
+    variant.name = "no-bit-states";
+    variant.options.bitStates = false;
+    variants.push_back(variant);
+    variant.name = "no-fixed-states";
+    variant.options.fixedStates = false;
+    variants.push_back(variant);
+
+    variant.options = options;
+    variant.name = "no-bidirectional";
+    variant.options.bidirectional = false;
+    variants.push_back(variant);
+    variant.options = options;
+    variant.name = "no-symmetry";
+    variant.options.symmetric = false;
+    variants.push_back(variant);
+    variant.options = options;
+    variant.name = "no-fillers";
+    variant.options.fillers = false;
+    variants.push_back(variant);
+
+    variant.name = "none";
+    variant.options.fixedStates = false;
+    variant.options.bitStates = false;
+    variant.options.bidirectional = false;
+    variant.options.symmetric = false;
+    variants.push_back(variant);
+    return variants;
+}
+
+
+// The length of the shortest plan from `board` to `goals` of at most `limit`
+// actions, -1 when there is none
+// A breadth first search keyed by the full board, with no move bound, table
+// or key of the solvers, so it can be trusted to check them
+int shortestPlanLength(State* board, GoalList* goals, int limit) {
+    if (goals->isSatisfied(board)) {
+        return 0;
+    }
+    unordered_set<uint64_t> seen;
+    seen.insert(board->getHash());
+    vector<State*> level(1, new State(board));
+    vector<State*> next;
+    MoveList acts;
+    int length = -1;
+    for (int depth = 1; depth <= limit && length < 0 && !level.empty(); depth++) {
+        for (size_t i = 0; i < level.size(); i++) {
+            acts.clear();
+            level[i]->getPossibleMoves(acts);
+            for (Action* a = acts.begin(); a != acts.end() && length < 0; a++) {
+                State* child = new State(level[i]);
+                child->performAction(*a);
+                if (!seen.insert(child->getHash()).second) {
+                    delete child;
+                    continue;
+                }
+                if (goals->isSatisfied(child)) {
+                    length = depth;
+                }
+                next.push_back(child);
+            }
+            delete level[i];
+        }
+        level.swap(next);
+        next.clear();
+    }
+    for (size_t i = 0; i < level.size(); i++) {
+        delete level[i];
+    }
+    return length;
+}
+
+
+// Whether every action of `plan` can be made in turn from `board` and leaves
+// it meeting `goals`, `board` itself isn't changed
+bool replayPlan(State* board, GoalList* goals, list<Action>& plan) {
+    State copy(board);
+    for (list<Action>::iterator i = plan.begin(); i != plan.end(); i++) {
+        if (!copy.isValidAction(*i)) {
+            return false;
+        }
+        copy.performAction(*i);
+    }
+    return goals->isSatisfied(&copy);
+}
+
+
+// Solves `problems` seeded problems, the first from `seed`, with every
+// optimal search and variant and checks them as described above
+// `limit` is the longest plan looked for and `options` are the switches the
+// variants start from
+// Returns the number of problems where any check failed
+int runSelfTest(ostream& out, int problems, unsigned int seed, int limit, const SolverOptions& options) {
+    const int strategies[] = {A_STAR_SEARCH, IDA_STAR_SEARCH, PARALLEL_A_STAR_SEARCH};
+    vector<SelfTestVariant> variants = getSelfTestVariants(options);
+    int failed = 0;
+    int checks = 0;
+
+    for (int problem = 1; problem <= problems; problem++) {
+        // Small boards, so that breadth first search and IDA* stay quick
+        srand(seed + problem - 1);
+        int size = 3 + (problem - 1) % 2;
+        int nums = getRand(size, size + 2);
+        State board(size, nums);
+        GoalList* goals = makeSelfTestGoals(&board, (problem - 1) % SELF_TEST_KINDS);
+        int shortest = shortestPlanLength(&board, goals, limit);
+        vector<string> failures;
+
+        for (int s = 0; s < 3; s++) {
+            long stateNodes = -1; // Nodes expanded on the first state tried
+            for (size_t v = 0; v < variants.size(); v++) {
+                string name = STRATEGY_KEYS[strategies[s]] + " " + variants[v].name;
+                Solver solver(new State(&board), goals->clone());
+                solver.setOptions(variants[v].options);
+                bool solved = solver.solve(strategies[s], limit);
+                int length = solved ? (int)solver.getPlan().size() : -1;
+                checks++;
+                if (length != shortest) {
+                    failures.push_back(name + " found length " + to_string(length));
+                }
+                else if (solved && !replayPlan(&board, goals, solver.getPlan())) {
+                    failures.push_back(name + " found a plan that doesn't reach the goals");
+                }
+                // Only A* and IDA* are deterministic, and only the first
+                // three variants search the same table
+                if (strategies[s] == PARALLEL_A_STAR_SEARCH || v > 2) {
+                    continue;
+                }
+                long nodes = solver.getStats().nodesExpanded;
+                if (stateNodes < 0) {
+                    stateNodes = nodes;
+                }
+                else if (nodes != stateNodes) {
+                    failures.push_back(name + " expanded " + to_string(nodes) + " nodes, not " + to_string(stateNodes));
+                }
+            }
+        }
+
+        out << "{\"problem\":" << problem << ",\"size\":" << size << ",\"nums\":" << nums;
+        out << ",\"goals\":\"" << (goals->isConjunctive() ? "conjunctive" : "disjunctive") << "\"";
+        out << ",\"count\":" << goals->getGoals().size() << ",\"length\":" << shortest;
+        out << ",\"passed\":" << (failures.empty() ? "true" : "false") << ",\"failures\":[";
+        for (size_t i = 0; i < failures.size(); i++) {
+            out << (i == 0 ? "" : ",") << "\"" << failures[i] << "\"";
+        }
+        out << "]}" << endl;
+        if (!failures.empty()) {
+            failed++;
+        }
+        delete goals;
+    }
+    out << "{\"problems\":" << problems << ",\"checks\":" << checks << ",\"failed\":" << failed << "}" << endl;
+    return failed;
+}
+
+
+#endif
@@ -1,13 +1,37 @@
 #include <unordered_set>
+#include <unordered_map>
 #include <string>
+#include <stdint.h>
 #include <vector>
 #include <list>
 #include <queue>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <chrono>
 
+#include "constants.h"
 #include "state.h"
 #include "action.h"
 #include "goalList.h"
 #include "randomness.h"
+#include "parallelSearch.h"
+#include "transpositionTable.h"
+#include "searchStats.h"
+#include "fixedState.h"
+#include "bitState.h"
+#include "optimalSolver.h"
+#include "goalProgram.h"
+#include "goalTracker.h"
+#include "moveList.h"
+#include "arena.h"
+#include "bidirectionalSearch.h"
+#include "boardAbstraction.h"
+#include "patternDatabase.h"
+#include "planCache.h"
+#include "solverOptions.h"
 
 using namespace std;
 
@@ -15,45 +39,422 @@ using namespace std;
 #define solver_H
 
 
+// One level of the best first search
+// `actions` is a min-heap of the untried actions ordered by heuristic, the
+// action at the front is the one currently being explored
+struct SearchFrame {
+    MoveBuffer<ScoredAction> actions;
+};
+
+
+// The best walk one thread of the random walk search has found
+struct WalkResult {
+    int length; // INT_MAX until a walk reaches the goal
+    int walk; // Index of the walk, the lower one wins a tie
+    vector<Action> actions;
+    SearchStats stats; // Counters of every walk the thread made
+};
+
+
 class Solver {
   list<Action> plan;
   State* mainState;
   GoalList* finalGoal;
-  unordered_set<string> hashSet;
+  GoalProgram program; // The goals compiled for the searches to evaluate
+  // The goal values of the board best first search and IDA* work on in place
+  GoalTracker tracker;
+  // The states the best first search has already seen, bounded in memory
+  TranspositionTable table;
+  // The explicit stack of the best first search, frames are kept between
+  // searches so their storage is reused rather than rebuilt for every level
+  vector<SearchFrame> frames;
+  unsigned int seed; // Seeds the random solver and the random walks
+  // Generator for the random solver, each solver has its own so that
+  // solvers on different threads never share one
+  mt19937 rng;
+  // Set by another thread to ask a running search to give up, may be NULL
+  atomic<bool>* stopFlag;
+  int threads; // Worker threads used by the parallel searches
+  int walks; // Walks made by the random walk search
+  // Whether A* and IDA* run on a state compiled for the board size when
+  // there is one, the dynamic State is used otherwise
+  bool fixedStates;
+  // Whether those boards are held as bitboards when they fit in one
+  bool bitStates;
+  // Whether A* and IDA* search from both ends when the goals name the board
+  bool bidirectional;
+  // Whether A* and IDA* key their tables so that boards differing only by a
+  // swap of columns the goals don't name are searched once
+  bool symmetric;
+  // And likewise boards differing only by a swap of tiles no goal names
+  bool fillers;
+  BoardAbstraction abstraction; // What may be swapped in this solve
+  // Raises the move bounds of the optimal searches when it fits the board,
+  // may be NULL
+  PatternDatabase* patterns;
+  PlanCache* cache; // Plans of earlier solves, may be NULL
+  // Memory for the nodes and tables of a solve, released when it ends
+  // `arena` is the solver's own unless one is shared with setArena
+  Arena ownArena;
+  Arena* arena;
+  SearchStats stats; // Counters of the last search
+  ProgressCallback progress; // May be empty
+  long progressInterval; // Expansions between calls to progress
+
+  void openFrame(State* node, int depth);
+  void closeFrame(State* node, int depth);
+  int randomIndex(int n);
+  static int dropReverse(MoveList& moves, Action& last);
+  void countExpansion(int depth, int successors);
+  void countLookup(bool hit) {if (hit) {stats.tableHits++;} else {stats.tableMisses++;}};
+  bool fixedSearch(int strategy, int limit, bool& handled);
+  bool pinnedSearch(int limit, bool& handled);
+  bool replayCached(bool optimal, int limit);
+  template<class S> bool runOptimal(int strategy, int limit);
+  void runWalks(int maxSteps, atomic<int>* nextWalk, atomic<int>* bestLength, WalkResult* result);
+  void notePeakTable(size_t entries) {stats.peakTableEntries = entries > stats.peakTableEntries ? entries : stats.peakTableEntries;};
 
   public:
     // Garbage collection of mainState and finalGoal is handled in destructor
-    Solver(State* s, GoalList* g) : mainState(s), finalGoal(g) {};
+    Solver(State* s, GoalList* g) :
+      mainState(s), finalGoal(g), program(g), tracker(&program), seed(rand()), rng(seed), stopFlag(NULL), threads(thread::hardware_concurrency()),
+      walks(DEFAULT_RANDOM_WALKS), fixedStates(true), bitStates(true), bidirectional(true), symmetric(true), fillers(true), patterns(NULL), cache(NULL), arena(&ownArena), progressInterval(0) {};
+    void setSeed(unsigned int s) {seed = s; rng.seed(s);};
+    void setStopFlag(atomic<bool>* flag) {stopFlag = flag;};
+    void setThreads(int t) {threads = t;};
+    void setWalks(int w) {walks = w;};
+    void setFixedStates(bool on) {fixedStates = on;};
+    void setBitStates(bool on) {bitStates = on;};
+    void setBidirectional(bool on) {bidirectional = on;};
+    void setSymmetric(bool on) {symmetric = on;};
+    void setFillers(bool on) {fillers = on;};
+    void setOptions(const SolverOptions& options);
+    void setPatternDatabase(PatternDatabase* db) {patterns = db; program.setPatternDatabase(db);};
+    void setPlanCache(PlanCache* c) {cache = c;};
+    // Solves one after another can share an arena so its slabs are reused
+    void setArena(Arena* a) {arena = a != NULL ? a : &ownArena;};
+    bool stopRequested() {return stopFlag != NULL && stopFlag->load(memory_order_relaxed);};
+    list<Action>& getPlan() {return plan;};
+    long getNodesExpanded() {return stats.nodesExpanded;};
+    const SearchStats& getStats() {return stats;};
+    void setProgressCallback(ProgressCallback callback, long everyNodes=100000);
+    State* getState() {return mainState;};
     void addToPlan(Action act);
     void printPlan();
-    bool hashExists(string hash);
+    void showResult(int strategy, bool found);
+    void setTableBudget(size_t bytes) {table.setBudget(bytes);};
+    TranspositionTable& getTable() {return table;};
+    bool hashExists(uint64_t hash);
+    bool solve(int strategy, int limit);
+    bool randomSearch(int maxSteps);
     bool bestFirstSearch(State* node, int maxRecurse);
-    void getHeuristicActions(
-      State* currentState,
-      priority_queue<Action, vector<Action>, greater<Action>>& q
-    );
+    void getHeuristicActions(State* currentState, MoveBuffer<ScoredAction>& heap, int depth);
+
+    bool aStarSearch(int maxDepth) {return runOptimal<State>(A_STAR_SEARCH, maxDepth);};
+    bool idaStarSearch(int maxDepth) {return runOptimal<State>(IDA_STAR_SEARCH, maxDepth);};
+    bool parallelSearch(int maxDepth);
+    bool randomWalkSearch(int maxSteps);
 
     void randomSolver(int maxSteps=100);
     void BFSSolver(int maxRecurse=100);
+    void AStarSolver(int maxDepth=100);
+    void IDAStarSolver(int maxDepth=100);
+    void HDAStarSolver(int maxDepth=100);
+    void randomWalkSolver(int maxSteps=100);
 
     ~Solver();
 };
 
+// Runs one of the search strategies without printing anything
+// `limit` is the maximum number of steps, recursions or plan length
+// Returns whether the goal was reached, the plan and winning board are then
+// available from getPlan and getState
+// The counters of the search are reset and then available from getStats
+// With a plan cache the plan is taken from it when it has one, and any plan
+// the search finds is added to it
+bool Solver::solve(int strategy, int limit) {
+    bool found = false;
+    bool handled = false;
+    stats = SearchStats();
+    // The states an earlier solve saw say nothing about this one
+    table.clear();
+    // Goals may have been added since the solver was made
+    program.compile(finalGoal);
+    abstraction.detect(program, mainState->getSize(), mainState->getNums(), symmetric, fillers);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    // Plans found by A*, IDA* and HDA* are known to be of minimum length
+    bool optimal = strategy == A_STAR_SEARCH || strategy == IDA_STAR_SEARCH || strategy == PARALLEL_A_STAR_SEARCH;
+    if (cache != NULL && replayCached(optimal, limit)) {
+        stats.totalMillis = millisSince(start);
+        return true;
+    }
+    // The cache is keyed by the board the solve starts from
+    State* initial = cache != NULL ? new State(mainState) : NULL;
+    size_t planBefore = plan.size();
+
+    if ((strategy == A_STAR_SEARCH || strategy == IDA_STAR_SEARCH) && bidirectional) {
+        found = pinnedSearch(limit, handled);
+    }
+    if ((strategy == A_STAR_SEARCH || strategy == IDA_STAR_SEARCH) && fixedStates && !handled) {
+        found = fixedSearch(strategy, limit, handled);
+    }
+    switch (handled ? -1 : strategy) {
+        case RANDOM_SEARCH:
+            found = randomSearch(limit);
+            break;
+        case BEST_FIRST_SEARCH:
+            // Put the root node in the hash set
+            hashExists(mainState->getHash());
+            found = bestFirstSearch(mainState, limit);
+            break;
+        case A_STAR_SEARCH:
+            found = aStarSearch(limit);
+            break;
+        case IDA_STAR_SEARCH:
+            found = idaStarSearch(limit);
+            break;
+        case PARALLEL_A_STAR_SEARCH:
+            found = parallelSearch(limit);
+            break;
+        case RANDOM_WALK_SEARCH:
+            found = randomWalkSearch(limit);
+            break;
+    }
+    // Nothing the search built in the arena outlives it
+    arena->release();
+    if (initial != NULL) {
+        if (found) {
+            list<Action>::iterator first = plan.begin();
+            advance(first, planBefore);
+            cache->store(initial, finalGoal, optimal, vector<Action>(first, plan.end()));
+        }
+        delete initial;
+    }
+
+    stats.totalMillis = millisSince(start);
+    // Searches that build the plan as they go spend all their time searching
+    if (stats.searchMillis == 0.0) {
+        stats.searchMillis = stats.totalMillis - stats.rebuildMillis;
+    }
+    return found;
+}
+
+
+// Runs A* or IDA* on a state compiled for the board size
+// Boards of up to BIT_STATE_MAX_SIZE with at most BIT_STATE_MAX_TILES tiles
+// are searched as bitboards
+// `handled` is left false when there is none and the caller must fall back
+// to the dynamic search
+bool Solver::fixedSearch(int strategy, int limit, bool& handled) {
+    bool bits = bitStates && mainState->getNums() <= BIT_STATE_MAX_TILES;
+    handled = true;
+    switch (mainState->getSize()) {
+        case 3:
+            return bits ? runOptimal< BitState<3> >(strategy, limit) : runOptimal< FixedState<3> >(strategy, limit);
+        case 4:
+            return bits ? runOptimal< BitState<4> >(strategy, limit) : runOptimal< FixedState<4> >(strategy, limit);
+        case 5:
+            return runOptimal< FixedState<5> >(strategy, limit);
+        case 6:
+            return runOptimal< FixedState<6> >(strategy, limit);
+        case 7:
+            return runOptimal< FixedState<7> >(strategy, limit);
+        case 8:
+            return runOptimal< FixedState<8> >(strategy, limit);
+    }
+    handled = false;
+    return false;
+}
+
+
+// Searches from both ends with BidirectionalSearch when the goals are a
+// conjunctive list of atom goals that places every tile, so the winning
+// board is known, the plan has the minimum length like A*'s and IDA*'s
+// `handled` is left false when the goals don't name a board, or when the
+// search outgrew its memory cap, and the caller must fall back to another search
+bool Solver::pinnedSearch(int limit, bool& handled) {
+    vector<int> boardDef;
+    handled = program.getPinnedBoard(mainState->getSize(), mainState->getNums(), boardDef);
+    if (!handled) {
+        return false;
+    }
+    State target(mainState->getSize(), mainState->getNums(), &boardDef[0]);
+    list<Action> path;
+    bool found;
+    {
+        BidirectionalSearch search(mainState, &target, arena, stats, progress, progressInterval, stopFlag);
+        found = search.search(limit, path);
+        handled = !search.wasCut();
+    }
+    if (found) {
+        for (list<Action>::iterator i = path.begin(); i != path.end(); i++) {
+            mainState->performAction(*i);
+            addToPlan(*i);
+        }
+    }
+    return found;
+}
+
+
+// Replays a plan from the cache when it has one for the main state and goals
+// The plan is checked as it is replayed, a record that doesn't lead to the
+// goals is undone and left to the search
+bool Solver::replayCached(bool optimal, int limit) {
+    vector<Action> cached;
+    if (!cache->lookup(mainState, finalGoal, optimal, limit, cached)) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < cached.size() && mainState->isValidAction(cached[done])) {
+        mainState->performAction(cached[done]);
+        done++;
+    }
+    if (done == cached.size() && program.isSatisfied(*mainState)) {
+        for (size_t i = 0; i < cached.size(); i++) {
+            addToPlan(cached[i]);
+        }
+        return true;
+    }
+    while (done > 0) {
+        done--;
+        mainState->reverseAction(cached[done]);
+    }
+    return false;
+}
+
+
+// Runs A* or IDA* on boards held as an `S`
+// On success the main state is moved along the plan to the winning board
+template<class S>
+bool Solver::runOptimal(int strategy, int limit) {
+    OptimalSolver<S> search(mainState, finalGoal, stats, progress, progressInterval, stopFlag, arena);
+    search.setPatternDatabase(patterns);
+    search.setAbstraction(abstraction);
+    list<Action> path;
+    bool found = strategy == A_STAR_SEARCH ? search.aStarSearch(limit, path) : search.idaStarSearch(limit, path);
+    if (found) {
+        for (list<Action>::iterator i = path.begin(); i != path.end(); i++) {
+            mainState->performAction(*i);
+            addToPlan(*i);
+        }
+    }
+    return found;
+}
+
+
+// Sets every switch of `options` at once
+void Solver::setOptions(const SolverOptions& options) {
+    setThreads(options.threads);
+    setWalks(options.walks);
+    setFixedStates(options.fixedStates);
+    setBitStates(options.bitStates);
+    setBidirectional(options.bidirectional);
+    setSymmetric(options.symmetric);
+    setFillers(options.fillers);
+}
+
+
+// Asks for `callback` to be called after every `everyNodes` expansions
+// The callback runs on the searching thread, the parallel search only
+// reports its counters once its workers have finished
+void Solver::setProgressCallback(ProgressCallback callback, long everyNodes) {
+    progress = callback;
+    progressInterval = everyNodes > 0 ? everyNodes : 1;
+}
+
+
+// Counts the expansion of a state at `depth` with `successors` actions and
+// reports progress when it is due
+void Solver::countExpansion(int depth, int successors) {
+    ::countExpansion(stats, depth, successors, progress, progressInterval);
+}
+
+
+// Prints the plan and the winning board if the strategy found a solution
+void Solver::showResult(int strategy, bool found) {
+    if (found) {
+        cout << "We found a solution using " << STRATEGY_NAMES[strategy] << "! Printing the plan..." << endl;
+        finalGoal->showSatisfied(mainState);
+        printPlan();
+        mainState->showBoard();
+    }
+    else {
+        cout << "No solution found :(" << endl;
+    }
+}
+
+
 // The random solver solves the game by picking a random action that is
 // not the reverse of the current action, hence reducing loops
 void Solver::randomSolver(int maxSteps) {
+    showResult(RANDOM_SEARCH, solve(RANDOM_SEARCH, maxSteps));
+}
+
+
+// The base function that begins executing the best first search and prints success
+void Solver::BFSSolver(int maxRecurse) {
+    showResult(BEST_FIRST_SEARCH, solve(BEST_FIRST_SEARCH, maxRecurse));
+}
+
+
+// Solves the game with A*, which always finds a plan of minimum length
+// `maxDepth` is the longest plan that will be considered
+void Solver::AStarSolver(int maxDepth) {
+    showResult(A_STAR_SEARCH, solve(A_STAR_SEARCH, maxDepth));
+}
+
+
+// Solves the game with iterative deepening A*, which finds a plan of minimum
+// length like A* but only ever stores the current path
+// `maxDepth` is the longest plan that will be considered
+void Solver::IDAStarSolver(int maxDepth) {
+    showResult(IDA_STAR_SEARCH, solve(IDA_STAR_SEARCH, maxDepth));
+}
+
+
+// Solves the game with hash distributed A* on every core, which finds a plan
+// of minimum length like A* but shares the states out between threads
+// `maxDepth` is the longest plan that will be considered
+void Solver::HDAStarSolver(int maxDepth) {
+    showResult(PARALLEL_A_STAR_SEARCH, solve(PARALLEL_A_STAR_SEARCH, maxDepth));
+}
+
+
+// Solves the game with many random walks on every core and keeps the shortest
+// `maxSteps` is the longest walk that will be tried
+void Solver::randomWalkSolver(int maxSteps) {
+    showResult(RANDOM_WALK_SEARCH, solve(RANDOM_WALK_SEARCH, maxSteps));
+}
+
+
+// Moves the action that undoes `last` to the end of `moves`
+// Returns how many actions to draw from, the reverse is only left in when it
+// is the one action there is (as on a 2x2 board with a single tile)
+int Solver::dropReverse(MoveList& moves, Action& last) {
+    int count = moves.size();
+    for (int i = 0; i < count && count > 1; i++) {
+        if (moves[i].isReverseOf(last)) {
+            Action reverse = moves[i];
+            moves[i] = moves[count - 1];
+            moves[count - 1] = reverse;
+            return count - 1;
+        }
+    }
+    return count;
+}
+
+
+// Walks the main state with random actions that do not undo the previous one
+bool Solver::randomSearch(int maxSteps) {
     Action prevAct;
     int levels = 0;
     // While we still have steps we can make and the board is not solved
-    while (levels < maxSteps && !finalGoal->isSatisfied(mainState)) {
+    while (levels < maxSteps && !program.isSatisfied(*mainState) && !stopRequested()) {
         // Sore all the current moves for the level of the tree
-        vector<Action> currentLevel;
+        MoveList currentLevel;
         mainState->getPossibleMoves(currentLevel);
-        Action choice = currentLevel.at(getRand(0, currentLevel.size() - 1));
-        // While the action is the reverse of the current action, get a new action
-        while (choice.isReverseOf(prevAct)) {
-            choice = currentLevel.at(getRand(0, currentLevel.size() - 1));
-        }
+        countExpansion(levels, currentLevel.size());
+        Action choice = currentLevel[randomIndex(dropReverse(currentLevel, prevAct))];
         // Perform the action
         mainState->performAction(choice);
         // Store it as the previous action
@@ -62,110 +463,249 @@ void Solver::randomSolver(int maxSteps) {
         addToPlan(choice);
         levels++;
     }
+    return program.isSatisfied(*mainState);
+}
 
-    // Print everything if satisfied or not
-    if (finalGoal->isSatisfied(mainState)) {
-        cout << "We found a solution using random actions! Printing the plan..." << endl;
-        printPlan();
-        mainState->showBoard();
+
+// Makes `walks` independent random walks of at most `maxSteps` actions over
+// `threads` threads and keeps the shortest one that reaches the goal
+// Walk i draws its actions from its own generator seeded with seed + i, so
+// the plan only depends on the seed however the walks are shared out, ties
+// in length go to the lowest walk
+// On success the main state is moved along the winning walk
+bool Solver::randomWalkSearch(int maxSteps) {
+    if (program.isSatisfied(*mainState)) {
+        return true;
     }
-    else {
-        cout << "No solution found :(" << endl;
+    int workers = threads > 0 ? threads : 1;
+    workers = workers < walks ? workers : walks;
+    atomic<int> nextWalk(0);
+    atomic<int> bestLength(INT_MAX);
+    vector<WalkResult> results(workers);
+    vector<thread> pool;
+
+    for (int i = 0; i < workers; i++) {
+        pool.push_back(thread(&Solver::runWalks, this, maxSteps, &nextWalk, &bestLength, &results[i]));
+    }
+    WalkResult* best = NULL;
+    for (int i = 0; i < workers; i++) {
+        pool[i].join();
+        stats.add(results[i].stats);
+        if (best == NULL || results[i].length < best->length ||
+            (results[i].length == best->length && results[i].walk < best->walk)) {
+            best = &results[i];
+        }
     }
+
+    if (best == NULL || best->length == INT_MAX) {
+        return false;
+    }
+    for (vector<Action>::iterator i = best->actions.begin(); i != best->actions.end(); i++) {
+        mainState->performAction(*i);
+        addToPlan(*i);
+    }
+    return true;
 }
 
 
-// The base function that begins executing the recursion and prints success
-void Solver::BFSSolver(int maxRecurse) {
-    // Put the root node in the hash set
-    hashExists(mainState->getHash());
-    if (bestFirstSearch(mainState, maxRecurse)) {
-        cout << "We found a solution using Best-first-search! Printing the plan..." << endl;
-        printPlan();
-        mainState->showBoard();
+// The body of one thread of the random walk search
+// Walks are taken from `nextWalk` until there are none left, each one on this
+// thread's own copy of the board, and the best of them is kept in `result`
+// A walk gives up once it is longer than the best walk found on any thread,
+// it could not win even if it reached the goal
+void Solver::runWalks(int maxSteps, atomic<int>* nextWalk, atomic<int>* bestLength, WalkResult* result) {
+    State walker(mainState);
+    FastRandom random;
+    MoveList moves;
+    vector<Action> walk;
+    result->length = INT_MAX;
+    result->walk = INT_MAX;
+
+    for (int w = nextWalk->fetch_add(1); w < walks && !stopRequested(); w = nextWalk->fetch_add(1)) {
+        random.setSeed((uint64_t)seed + w);
+        walk.clear();
+        bool solved = false;
+        while ((int)walk.size() < maxSteps && (int)walk.size() < bestLength->load(memory_order_relaxed)) {
+            moves.clear();
+            walker.getPossibleMoves(moves);
+            result->stats.nodesExpanded++;
+            result->stats.successorsGenerated += moves.size();
+            int count = walk.empty() ? moves.size() : dropReverse(moves, walk.back());
+            Action choice = moves[random.below(count)];
+            walker.performAction(choice);
+            walk.push_back(choice);
+            if (program.isSatisfied(walker)) {
+                solved = true;
+                break;
+            }
+        }
+        int length = walk.size();
+        result->stats.maxDepth = length > result->stats.maxDepth ? length : result->stats.maxDepth;
+
+        if (solved && (length < result->length || (length == result->length && w < result->walk))) {
+            result->length = length;
+            result->walk = w;
+            result->actions = walk;
+            // Let the other threads cut their walks short
+            int known = bestLength->load(memory_order_relaxed);
+            while (length < known && !bestLength->compare_exchange_weak(known, length, memory_order_relaxed)) {}
+        }
+        // Walk back to the starting board for the next walk
+        for (vector<Action>::reverse_iterator i = walk.rbegin(); i != walk.rend(); i++) {
+            walker.reverseAction(*i);
+        }
     }
-    else {
-        cout << "No solution found :(" << endl;
+}
+
+
+// Gets a random index into a list of `n` items using the solver's own generator
+int Solver::randomIndex(int n) {
+    return uniform_int_distribution<int>(0, n - 1)(rng);
+}
+
+
+// Runs hash distributed A* over `threads` workers
+// On success the winning board becomes the main state and the plan is rebuilt
+bool Solver::parallelSearch(int maxDepth) {
+    State* winningState = NULL;
+    bool found;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        ParallelSearch search(mainState, finalGoal, threads, stopFlag);
+        search.setPatternDatabase(patterns);
+        found = search.search(maxDepth, plan, winningState);
+        stats.add(search.getStats());
+        stats.searchMillis = millisSince(start);
+        start = chrono::steady_clock::now();
+        // Every node is freed as the search goes out of scope
     }
+    stats.rebuildMillis = millisSince(start);
+    if (!found) {
+        return false;
+    }
+    delete mainState;
+    mainState = winningState;
+    return true;
 }
 
 
-// The true recursive best first search algorithm
-// `node` is the currently analysed state in the tree (the root node for the context)
-// `maxRecurse` limits the number of recursions to be memory safe
+// The best first search algorithm
+// The search is a depth-first walk that always tries the action with the best
+// heuristic first. It is driven by an explicit stack of frames rather than by
+// recursion, so deep searches are limited by memory rather than the call stack
+// `node` is the root state, actions are applied and undone on it in place so
+// on success `node` is left as the winning board
+// `maxRecurse` limits the length of the plan
 bool Solver::bestFirstSearch(State* node, int maxRecurse) {
-    // If at the end of the recursion, terminate with false
+    // If there is no room for a single action, terminate with false
     if (maxRecurse < 1) {
         return false;
     }
-    // Get the ordered queue of the possible actions
-    priority_queue<Action, vector<Action>, greater<Action>> nextActions;
-    // Assign the heuristics to them
-    getHeuristicActions(node, nextActions);
+    int depth = 0;
+    tracker.reset(*node);
+    openFrame(node, depth);
+
+    while (depth >= 0) {
+        // Another solver won the race, unwind back to the root board
+        if (stopRequested()) {
+            while (depth > 0) {
+                depth--;
+                closeFrame(node, depth);
+            }
+            return false;
+        }
+        // Every action of this level failed, go back up a level
+        if (frames[depth].actions.empty()) {
+            depth--;
+            if (depth >= 0) {
+                closeFrame(node, depth);
+            }
+            continue;
+        }
 
-    // Iterate through the ordered actions
-    while (!nextActions.empty()) {
-        // Store the best action
-        Action nextAct = nextActions.top();
-        State* nextNode = new State(node); // Copy the current node
-        nextNode->performAction(nextAct); // Perform the action
-        addToPlan(nextAct); // Add it to the plan before recursing
+        // Try the best untried action
+        Action nextAct = frames[depth].actions.front().act;
+        node->performAction(nextAct); // Perform the action
+        tracker.apply(*node, nextAct);
+        addToPlan(nextAct); // Add it to the plan before going deeper
 
         // If this action leads to a winning board, say that it was found
-        if (finalGoal->isSatisfied(nextNode)) {
-            delete mainState; // Free up the old mainState
-            // Set the winning board to be the main state
-            mainState = nextNode;
+        if (program.isSatisfied(*node)) {
             return true;
-            // Else recurse and catch any found solutions
         }
-        else if (bestFirstSearch(nextNode, maxRecurse - 1)) {
-            delete nextNode; // Free up any memory used
-            return true;
+        // Else go a level deeper if the plan is allowed to grow
+        if (depth + 1 < maxRecurse) {
+            depth++;
+            openFrame(node, depth);
+        }
+        else {
+            closeFrame(node, depth);
         }
-        // Else the action was unsuccessful, delete unecessary data
-        delete nextNode;
-        plan.pop_back(); // Get rid of the failed action
-        nextActions.pop(); // move to the next action
     }
     return false;
 }
 
 
-// Gets the priority queue of all the actions for a current state
+// Fills in the frame at `depth` with the ordered actions of `node`
+// Frames are only ever added, never freed, so that their storage is reused
+void Solver::openFrame(State* node, int depth) {
+    if ((int)frames.size() <= depth) {
+        frames.resize(depth + 1);
+    }
+    frames[depth].actions.clear();
+    // The actions lead to states one level below this frame
+    getHeuristicActions(node, frames[depth].actions, depth + 1);
+}
+
+
+// Undoes the action being explored at `depth` and moves on to the next one
+void Solver::closeFrame(State* node, int depth) {
+    MoveBuffer<ScoredAction>& actions = frames[depth].actions;
+    node->reverseAction(actions.front().act);
+    tracker.undo();
+    plan.pop_back(); // Get rid of the failed action
+    pop_heap(actions.begin(), actions.end(), greater<ScoredAction>());
+    actions.pop_back();
+}
+
+
+// Gets the ordered heap of all the actions for a current state
 // This function is needed to filter out duplicate states and
-// to convert a vector into a priority queue
-void Solver::getHeuristicActions(
-    State* currentState,
-    priority_queue<Action, vector<Action>, greater<Action>>& q
-) {
-    vector<Action> allActs;
+// to order the actions by their heuristic
+// `depth` is the plan length at which the resulting states are reached
+void Solver::getHeuristicActions(State* currentState, MoveBuffer<ScoredAction>& heap, int depth) {
+    MoveList allActs;
     currentState->getPossibleMoves(allActs);
-    for (vector<Action>::iterator i = allActs.begin(); i != allActs.end(); i++) {
-        // Perform the action so the state can be analysed
-        currentState->performAction(*i);
-        // If the hash of the state doesn't exist, then check the heuristic
-        if (!hashExists(currentState->getHash())) {
-            finalGoal->getActionHeuristic(currentState, &(*i));
-            // After the heuristic is added to the action, load it into the queue
-            q.push(*i);
+    countExpansion(depth - 1, allActs.size());
+    // The actions whose resulting state doesn't exist yet go on the end of the
+    // heap to be scored, the keys are worked out without performing them
+    int first = heap.size();
+    for (Action* i = allActs.begin(); i != allActs.end(); i++) {
+        bool exists = hashExists(currentState->getHashAfter(*i));
+        countLookup(exists);
+        if (!exists) {
+            ScoredAction move = {0.0, *i};
+            heap.push_back(move);
         }
-        // Reverse the current state for the next action to test
-        currentState->reverseAction(*i);
     }
+    // Score all of the new states in one pass
+    int fresh = heap.size() - first;
+    if (fresh > 0) {
+        program.scoreActions(*currentState, tracker.getDistances(), heap.begin() + first, fresh);
+        stats.heuristicEvaluations += fresh;
+    }
+    for (int i = first; i < heap.size(); i++) {
+        // Sift the actions into the heap in turn, as if pushed one at a time
+        push_heap(heap.begin(), heap.begin() + i + 1, greater<ScoredAction>());
+    }
+    notePeakTable(table.getUsed());
 }
 
 
 // Automatically store nonexistent hashes and return whether they already exist
 // This is used to prune the tree from duplicates and reverse states and actions
-bool Solver::hashExists(string hash) {
-    if (hashSet.count(hash) > 0) {
-        return true;
-    }
-    else {
-        hashSet.insert(hash);
-        return false;
-    }
+bool Solver::hashExists(uint64_t hash) {
+    return table.store(hash);
 }
 
 
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <cstdlib>
+
+#include "constants.h"
+
+using namespace std;
+
+#ifndef solverOptions_H
+#define solverOptions_H
+
+
+// The switches of a Solver that the batch mode and the bench take from the
+// command line, see Solver::setOptions
+// They only change how a strategy searches, not the plan it finds
+struct SolverOptions {
+    int threads; // Worker threads used by the parallel searches
+    int walks; // Walks made by the random walk search
+    bool fixedStates; // A* and IDA* on a state compiled for the board size
+    bool bitStates; // Those boards held as bitboards when they fit in one
+    bool bidirectional; // A* and IDA* from both ends when the goals name the board
+    bool symmetric; // Boards differing by a swap of free columns searched once
+    bool fillers; // Boards differing by a swap of unnamed tiles searched once
+
+    SolverOptions();
+};
+
+
+// Flags read by readSolverOption, for usage messages
+const string SOLVER_OPTIONS_USAGE =
+    "[--threads n] [--walks n] [--no-fixed-states] [--no-bit-states] [--no-bidirectional] [--no-symmetry] [--no-fillers]";
+
+
+// Every switch on, as a Solver starts
+SolverOptions::SolverOptions() :
+    threads(thread::hardware_concurrency()), walks(DEFAULT_RANDOM_WALKS), fixedStates(true), bitStates(true),
+    bidirectional(true), symmetric(true), fillers(true) {}
+
+
+// Reads the flag at argv[i] into `options` when it is one of SOLVER_OPTIONS_USAGE
+// Returns 1 when it was, with `i` left on its last token, 0 when it isn't one
+// of them and -1, after complaining, when its value is bad
+int readSolverOption(int argc, char** argv, int& i, SolverOptions& options) {
+    string arg = argv[i];
+    if ((arg == "--threads" || arg == "--walks") && i + 1 < argc) {
+        int value = atoi(argv[++i]);
+        if (value < 1) {
+            cerr << arg << " must be at least 1" << endl;
+            return -1;
+        }
+        (arg == "--threads" ? options.threads : options.walks) = value;
+    } else if (arg == "--no-fixed-states") {
+        options.fixedStates = false;
+    } else if (arg == "--no-bit-states") {
+        options.bitStates = false;
+    } else if (arg == "--no-bidirectional") {
+        options.bidirectional = false;
+    } else if (arg == "--no-symmetry") {
+        options.symmetric = false;
+    } else if (arg == "--no-fillers") {
+        options.fillers = false;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+
+// The flags that readSolverOption reads back into `options`
+string formatSolverOptions(const SolverOptions& options) {
+    stringstream flags;
+    flags << "--threads " << options.threads << " --walks " << options.walks;
+    if (!options.fixedStates) {
+        flags << " --no-fixed-states";
+    }
+    if (!options.bitStates) {
+        flags << " --no-bit-states";
+    }
+    if (!options.bidirectional) {
+        flags << " --no-bidirectional";
+    }
+    if (!options.symmetric) {
+        flags << " --no-symmetry";
+    }
+    if (!options.fillers) {
+        flags << " --no-fillers";
+    }
+    return flags.str();
+}
+
+
+#endif
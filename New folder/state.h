@@ -1,9 +1,12 @@
 #include <vector>
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 #include "constants.h"
 #include "action.h"
+#include "moveList.h"
+#include "arena.h"
 #include "randomness.h"
 #include <algorithm>    // std::random_shuffle
 
@@ -15,19 +18,33 @@ using namespace std;
 
 
 class State {
-  int** board;
+  // The board is one contiguous block laid out column by column:
+  // cells[col * size + row] is the tile at (row, col), row 0 being the bottom.
+  // The column heights and the tile index (positions[tile] is the cell the
+  // tile sits in, or -1 when it is not on the board) live directly after the
+  // cells in the same block so that a whole state can be copied with a
+  // single memcpy.
+  int* cells;
+  int* heights;
+  int* positions;
   int size;
   int nums;
+  Arena* arena; // Holds the block when the state was copied into one, else NULL
+  // Zobrist key of the board, kept up to date by every push and pop
+  uint64_t hash;
 
   int top(int col);
   bool isEmpty(int col);
   int popFromCol(int col);
+  int blockLength() {return size * size + size + nums + 1;};
 
   public:
+    typedef uint64_t Key; // As FixedState and BitState, so the optimal searches take any of them
     double maxHeuristic;
 
-    State() {}; // Empty constructor (do not construct like this unless it is a placeholder)
+    State() : cells(NULL), heights(NULL), positions(NULL), size(0), nums(0), arena(NULL), hash(0) {}; // Empty constructor (do not construct like this unless it is a placeholder)
     State(State* s); // Copy constructor
+    State(State* s, Arena* a); // Copy whose board lives in the arena
     State(int s, int n);
     State(int s, int n, int* boardDef);
     void initBoard();
@@ -35,7 +52,8 @@ class State {
     void randomiseBoard();
     int getSize() {return size;};
     int getNums() {return nums;};
-    int** getBoard() {return board;}
+    int at(int row, int col) {return cells[col * size + row];};
+    int getHeight(int col) {return heights[col];};
     void find(int num, int& x, int& y);
     int topTile(int col);
     void showBoard();
@@ -43,34 +61,47 @@ class State {
     bool isValidAction(Action& a);
     void performAction(Action& a);
     void reverseAction(Action& a);
-    void getPossibleMoves(vector<Action>& actionList);
-    string getHash();
+    void getPossibleMoves(MoveList& actionList);
+    uint64_t getHash() {return hash;};
+    uint64_t getHashAfter(Action& a);
+    Key getKey() {return hash;};
     ~State();
 };
 
 
 // Copy constructor
 State::State(State* s) {
+    arena = NULL;
     size = s->getSize();
     nums = s->getNums();
     // Initialise the memory for the board
     initBoard();
-    // Copy the board
-    int** otherBoard = s->getBoard();
-    for (int x = 0; x < size; x++) {
-        for (int y = 0; y < size; y++) {
-            board[x][y] = otherBoard[x][y];
-        }
-    }
+    // Copy the board and the column heights in one go
+    memcpy(cells, s->cells, blockLength() * sizeof(int));
+    hash = s->getHash();
     // Get the heuristic
     maxHeuristic = s->maxHeuristic;
 }
 
 
+// Copies a state with its board block taken from `a`, which must outlive it
+// The state itself may be built in the arena too, see Arena::destroy
+State::State(State* s, Arena* a) {
+    arena = a;
+    size = s->getSize();
+    nums = s->getNums();
+    initBoard();
+    memcpy(cells, s->cells, blockLength() * sizeof(int));
+    hash = s->getHash();
+    maxHeuristic = s->maxHeuristic;
+}
+
+
 // Starts a state with a completely random board
 // s is the size of the board (eg s=3, it will create a 3x3 board)
 // n is the amount of numbers to place on the board
 State::State(int s, int n) {
+    arena = NULL;
     size = s;
     nums = n;
     maxHeuristic = sqrt(2.0 * pow((double)size, 2.0));
@@ -80,7 +111,10 @@ State::State(int s, int n) {
 }
 
 
+// Starts a state from a board definition given row by row from the bottom
+// (boardDef[(row * size) + col]), tiles are pushed in so the columns stay stacked
 State::State(int s, int n, int* boardDef) {
+    arena = NULL;
     size = s;
     nums = n;
     maxHeuristic = sqrt(2.0 * pow((double)size, 2.0));
@@ -89,7 +123,9 @@ State::State(int s, int n, int* boardDef) {
 
     for (int x = 0; x < size; x++) {
         for (int y = 0; y < size; y++) {
-            board[x][y] = boardDef[(x * size) + y];
+            if (boardDef[(x * size) + y] != 0) {
+                pushToCol(boardDef[(x * size) + y], y);
+            }
         }
     }
 }
@@ -97,23 +133,25 @@ State::State(int s, int n, int* boardDef) {
 
 // Zeroes-out the board and initialises memory, ready for game setup
 void State::initBoard() {
-    board = new int* [size];
-    for (int x = 0; x < size; x++) {
-        board[x] = new int[size];
-        for (int y = 0; y < size; y++) {
-            board[x][y] = 0;
-        }
+    if (arena != NULL) {
+        cells = (int*)arena->allocate(blockLength() * sizeof(int));
     }
+    else {
+        cells = new int[blockLength()];
+    }
+    heights = cells + size * size;
+    positions = heights + size;
+    clearBoard();
 }
 
 
 // Zeroes-out the board
 void State::clearBoard() {
-    for (int x = 0; x < size; x++) {
-        for (int y = 0; y < size; y++) {
-            board[x][y] = 0;
-        }
+    memset(cells, 0, (size * size + size) * sizeof(int));
+    for (int i = 0; i <= nums; i++) {
+        positions[i] = -1;
     }
+    hash = 0;
 }
 
 
@@ -151,14 +189,9 @@ void State::find(int num, int& x, int& y) {
     x = 0;
     y = 0;
 
-    for (int cx = 0; cx < size; cx++) {
-        for (int cy = 0; cy < size; cy++) {
-            if (board[cx][cy] == num) {
-                x = cx;
-                y = cy;
-                return;
-            }
-        }
+    if (num > 0 && num <= nums && positions[num] >= 0) {
+        x = positions[num] % size;
+        y = positions[num] / size;
     }
 }
 
@@ -167,75 +200,59 @@ void State::find(int num, int& x, int& y) {
 // Zero means that it has space
 int State::top(int col) {
     assert(col < size && col >= 0);
-    return board[size - 1][col];
+    return heights[col] == size ? cells[col * size + size - 1] : 0;
 }
 
 
 // Gets the top-most tile in the column else returns zero
 // Zero means it is empty
-// Algorithm keeps iterating until it reaches the bottom of a column or a tile
 int State::topTile(int col) {
     if (isEmpty(col)) {
         return 0;
     }
-    else {
-        // Note: we could just pop and push back but that would be inefficient
-        int i = size - 1;
-        int current = board[i][col];
-        while (current == 0 && i > 0) {
-            i--;
-            current = board[i][col];
-        }
-        return current;
-    }
+    return cells[col * size + heights[col] - 1];
 }
 
 
 // Checks if there is a tile in a column
 bool State::isEmpty(int col) {
     assert(col < size && col >= 0);
-    return board[0][col] == 0;
+    return heights[col] == 0;
 }
 
 
-// Pushes a value into a column only if it has space
-// Algorithm keeps iterating until it reaches the bottom of a column or a zero
-// before a tile
+// Pushes a value onto a column only if it has space
 void State::pushToCol(int val, int col) {
     assert(top(col) == 0 && val > 0 && val <= nums);
-    int i = 0;
-    int current = board[0][col];
-    while (current != 0 && i < size - 1) {
-        i++;
-        current = board[i][col];
-    }
-
-    if (current == 0) {
-        board[i][col] = val;
+    if (heights[col] < size) {
+        cells[col * size + heights[col]] = val;
+        positions[val] = col * size + heights[col];
+        hash ^= getZobrist(val, col * size + heights[col]);
+        heights[col]++;
     }
 }
 
 
 // Pops and returns a value from a column only if a tile exists
-// Algorithm keeps iterating until it reaches the bottom of a column or a zero
-// before a tile
 int State::popFromCol(int col) {
     assert(!isEmpty(col));
-    int i = size - 1;
-    int current = board[i][col];
-    while (current == 0 && i > 0) {
-        i--;
-        current = board[i][col];
-    }
-
-    if (current != 0) {
-        int temp = board[i][col];
-        board[i][col] = 0;
-        return temp;
-    }
-    else {
+    if (heights[col] == 0) {
         return 0;
     }
+    heights[col]--;
+    int temp = cells[col * size + heights[col]];
+    cells[col * size + heights[col]] = 0;
+    positions[temp] = -1;
+    hash ^= getZobrist(temp, col * size + heights[col]);
+    return temp;
+}
+
+
+// Gets the key the board would have after a valid action, without performing it
+uint64_t State::getHashAfter(Action& a) {
+    int from = a.getFromCol() * size + heights[a.getFromCol()] - 1;
+    int to = a.getToCol() * size + heights[a.getToCol()];
+    return hash ^ getZobrist(cells[from], from) ^ getZobrist(cells[from], to);
 }
 
 
@@ -262,7 +279,7 @@ void State::reverseAction(Action& a) {
 
 
 // Get all the possible moves that can be performed
-void State::getPossibleMoves(vector<Action>& actionList) {
+void State::getPossibleMoves(MoveList& actionList) {
     // Iterate through all the columns
     for (int col = 0; col < size; col++) {
         // Actions can only occur from a column with tiles, skip empty columns
@@ -281,20 +298,6 @@ void State::getPossibleMoves(vector<Action>& actionList) {
 }
 
 
-// Convert all numbers on the board to a string
-// This will make a unique identifier for a particular state without
-// having to program an equality overloader
-string State::getHash() {
-    string hash = "";
-    for (int x = 0; x < size; x++) {
-        for (int y = 0; y < size; y++) {
-            hash += (char)board[x][y] + 48;
-        }
-    }
-    return hash;
-}
-
-
 void State::showBoard() {
     int mag = floor(log10(nums));
     // Push to a new line
@@ -319,8 +322,8 @@ void State::showBoard() {
     for (int x = size - 1; x >= 0; x--) {
         cout << preRowSep;
         for (int y = 0; y < size; y++) {
-            if (board[x][y] != 0) {
-                cout << "| " << board[x][y] << string(1 + mag - (int)floor(log10(board[x][y])), ' ');
+            if (at(x, y) != 0) {
+                cout << "| " << at(x, y) << string(1 + mag - (int)floor(log10(at(x, y))), ' ');
             }
             else {
                 cout << "|" << string(3 + mag, ' ');
@@ -335,11 +338,13 @@ void State::showBoard() {
 
 
 State::~State() {
-    for (int x = 0; x < size; x++) {
-        delete[] board[x];
+    // The heights share the block with the cells
+    if (arena != NULL) {
+        arena->deallocate(cells, blockLength() * sizeof(int));
+    }
+    else {
+        delete[] cells;
     }
-
-    delete[] board;
 }
 
 
@@ -0,0 +1,225 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+#ifndef transpositionTable_H
+#define transpositionTable_H
+
+// Memory budget of a table unless told otherwise
+const size_t DEFAULT_TABLE_BYTES = 64 * 1024 * 1024;
+// Size the table starts at, it doubles from here until it reaches its budget
+const size_t INITIAL_TABLE_BYTES = 64 * 1024;
+const int CACHE_LINE_BYTES = 64;
+const int ENTRIES_PER_BUCKET = 8;
+// Buckets a key may be stored in, its own and the ones after it
+const int PROBE_BUCKETS = 4;
+
+
+// A state remembered by the table, 8 bytes so that eight fit in a cache line
+struct TableEntry {
+    uint64_t key; // Zobrist key of the state, zero marks an empty entry
+};
+
+
+// One cache line of entries
+struct TableBucket {
+    TableEntry entries[ENTRIES_PER_BUCKET];
+};
+
+
+// A fixed-budget open-addressing table of visited states
+// A key goes in the first free entry of its own bucket or, when that is
+// full, of one of the next PROBE_BUCKETS - 1 buckets, so a lookup reads a
+// few neighbouring lines and stops at the first one with a free entry.
+// The table doubles whenever it is three quarters full, so below its budget
+// no state is ever forgotten. Once it has used the whole budget a new state
+// replaces an entry of its own bucket picked by the key's high bits.
+// The table only says whether a state was seen, not at what depth: searching
+// a state again when it is reached shallower makes the best first search
+// exponential on boards it otherwise solves at once
+class TranspositionTable {
+  char* memory; // The raw allocation, buckets starts at the first cache line in it
+  TableBucket* buckets;
+  size_t bucketCount; // Always a power of two
+  size_t budgetBuckets; // Most buckets the memory budget allows
+  size_t initialBuckets; // Buckets the table starts with and goes back to when cleared
+  size_t used; // Entries in use
+
+  void allocate(size_t count);
+  TableBucket* bucketOf(uint64_t key, int step) {return &buckets[(key + step) & (bucketCount - 1)];};
+  TableEntry* freeEntry(uint64_t key);
+  TableEntry* insert(uint64_t key);
+  void grow();
+
+  public:
+    TranspositionTable(size_t bytes=DEFAULT_TABLE_BYTES);
+    void setBudget(size_t bytes);
+    void clear();
+    TableEntry* probe(uint64_t key);
+    bool store(uint64_t key);
+    size_t getUsed() {return used;};
+    size_t getCapacity() {return bucketCount * ENTRIES_PER_BUCKET;};
+    size_t getBytes() {return bucketCount * sizeof(TableBucket);};
+    ~TranspositionTable();
+
+  private:
+    TranspositionTable(const TranspositionTable&);
+    TranspositionTable& operator=(const TranspositionTable&);
+};
+
+
+// `bytes` is the most memory the table may use, it is rounded down to a power
+// of two number of buckets
+TranspositionTable::TranspositionTable(size_t bytes) :
+    memory(NULL), buckets(NULL), bucketCount(0), budgetBuckets(1), initialBuckets(1), used(0) {
+    setBudget(bytes);
+}
+
+
+// Changes the memory budget, the table is emptied
+void TranspositionTable::setBudget(size_t bytes) {
+    budgetBuckets = 1;
+    while (budgetBuckets * 2 * sizeof(TableBucket) <= bytes) {
+        budgetBuckets *= 2;
+    }
+    initialBuckets = 1;
+    while (initialBuckets * 2 * sizeof(TableBucket) <= INITIAL_TABLE_BYTES && initialBuckets * 2 <= budgetBuckets) {
+        initialBuckets *= 2;
+    }
+    allocate(initialBuckets);
+}
+
+
+// Replaces the buckets with `count` empty ones aligned to a cache line
+void TranspositionTable::allocate(size_t count) {
+    free(memory);
+    memory = (char*)malloc(count * sizeof(TableBucket) + CACHE_LINE_BYTES);
+    buckets = (TableBucket*)(((uintptr_t)memory + CACHE_LINE_BYTES - 1) & ~(uintptr_t)(CACHE_LINE_BYTES - 1));
+    bucketCount = count;
+    memset(buckets, 0, bucketCount * sizeof(TableBucket));
+    used = 0;
+}
+
+
+// Forgets every state, a table that has grown goes back to its initial size
+void TranspositionTable::clear() {
+    if (bucketCount != initialBuckets) {
+        allocate(initialBuckets);
+    }
+    else if (used > 0) {
+        memset(buckets, 0, bucketCount * sizeof(TableBucket));
+        used = 0;
+    }
+}
+
+
+// Finds the entry of a state, NULL if the state is not in the table
+TableEntry* TranspositionTable::probe(uint64_t key) {
+    key = key == 0 ? 1 : key; // Zero is reserved for empty entries
+    for (int step = 0; step < PROBE_BUCKETS; step++) {
+        TableBucket* bucket = bucketOf(key, step);
+        bool full = true;
+        for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+            if (bucket->entries[i].key == key) {
+                return &bucket->entries[i];
+            }
+            full = full && bucket->entries[i].key != 0;
+        }
+        // Entries are never emptied, so a key would have gone in here
+        if (!full) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+
+// Records that a state was reached
+// Returns whether the state was already in the table
+bool TranspositionTable::store(uint64_t key) {
+    key = key == 0 ? 1 : key; // Zero is reserved for empty entries
+    if (probe(key) != NULL) {
+        return true;
+    }
+    insert(key);
+    return false;
+}
+
+
+// The first free entry of the buckets a key may be stored in, NULL if they
+// are all full
+TableEntry* TranspositionTable::freeEntry(uint64_t key) {
+    for (int step = 0; step < PROBE_BUCKETS; step++) {
+        TableBucket* bucket = bucketOf(key, step);
+        for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+            if (bucket->entries[i].key == 0) {
+                return &bucket->entries[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+
+// Claims an entry for a new key, growing the table or replacing an entry
+// Entries are only ever replaced once the table has used its whole budget
+TableEntry* TranspositionTable::insert(uint64_t key) {
+    // Keep the load low while there is still budget to grow into
+    if (used * 4 >= getCapacity() * 3 && bucketCount < budgetBuckets) {
+        grow();
+    }
+    TableEntry* entry = freeEntry(key);
+    // Buckets that fill up before the table does are rare, and a table with
+    // budget left makes room rather than forgetting a state
+    while (entry == NULL && bucketCount < budgetBuckets) {
+        grow();
+        entry = freeEntry(key);
+    }
+    if (entry != NULL) {
+        entry->key = key;
+        used++;
+        return entry;
+    }
+
+    // Every bucket is full, the low bits picked the bucket so the high bits
+    // pick the entry to replace
+    TableEntry* victim = &bucketOf(key, 0)->entries[(key >> 32) % ENTRIES_PER_BUCKET];
+    victim->key = key;
+    return victim;
+}
+
+
+// Doubles the number of buckets and moves every entry into its new bucket
+// The new table is at most three eighths full, so an entry that finds its
+// buckets full is vanishingly rare; it is then dropped like a replaced one
+void TranspositionTable::grow() {
+    char* oldMemory = memory;
+    TableBucket* oldBuckets = buckets;
+    size_t oldCount = bucketCount;
+    memory = NULL;
+    allocate(oldCount * 2);
+
+    for (size_t b = 0; b < oldCount; b++) {
+        for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+            TableEntry& old = oldBuckets[b].entries[i];
+            if (old.key != 0) {
+                TableEntry* entry = freeEntry(old.key);
+                if (entry != NULL) {
+                    *entry = old;
+                    used++;
+                }
+            }
+        }
+    }
+    free(oldMemory);
+}
+
+
+TranspositionTable::~TranspositionTable() {
+    free(memory);
+}
+
+
+#endif